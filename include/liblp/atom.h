@@ -28,6 +28,8 @@
 #define _ATOM_H_DATE     "$Date: 2023/02/25 13:23:06 $"
 #define _ATOM_H_REVISION "$Revision: 1.19 $"
 
+#include <stdint.h>
+
 extern void _version_atom_c();
 
 /* Status bits for atoms */
@@ -47,34 +49,86 @@ extern void _version_atom_c();
 #define MARK_FACT    0x400  /* The definition is trvialized by a fact */
 #define MARK_CHOICE  0x800  /* Occurs in bodyless choice */
 
+#define STATUS_FLAGS 12     /* Number of status bits */
+
+/* Status bits of the atoms of a piece: each flag has a bitset of its own
+   (NULL until the flag is set for some atom) where the bit of index i is
+   bit i%64 of word i/64 */
+
+typedef struct astatus {
+  int words;                /* Length of each bitset */
+  uint64_t *bits[STATUS_FLAGS];
+} ASTATUS;
+
 /* Atom table */
 
+struct aindex;
+struct amap;
+
 typedef struct atab {
   int count;                /* Number of atoms */
   int offset;               /* Index value = atom number - offset */
   int shift;                /* Enables global shift of atom numbers */
   char *prefix;             /* Added to symbolic names */
   char *postfix;            /* Added to symbolic names */
+  int prefix_len;           /* Lengths of the above */
+  int postfix_len;
   struct atab *other;       /* Cross-referenced table */
   struct atab *next;        /* Next piece */
   struct atab *last;        /* Last piece -- only defined for the first */
+  struct atab *first;       /* First piece (holding the index and map) */
+  struct aindex *index;     /* Index of pieces -- only for the first */
+  struct amap *map;         /* Names to atoms -- only for the first */
   SYMBOL **names;           /* Vector of names */
-  int *statuses;            /* Vector of status bits */
+  ASTATUS *statuses;        /* Status bits (see above) */
   int *others;              /* Vector of cross-references */
 } ATAB;
 
 /* Atom tables may consist of several pieces; see the next field above: */
 
+/* Pieces sorted by atom numbers for fast lookups (see find_atom) */
+
+typedef struct apiece {
+  int low;                  /* Atoms low+1..high are in the piece */
+  int high;
+  ATAB *piece;
+} APIECE;
+
+typedef struct aindex {
+  int count;                /* Number of pieces indexed */
+  int size;                 /* Size of the vector of pieces */
+  int usable;               /* Pieces do not overlap */
+  ATAB *last;               /* Last piece indexed */
+  APIECE *pieces;           /* Pieces in ascending order */
+} AINDEX;
+
+/* Reverse map from names (strings) to atoms (see find_atoms_by_names) */
+
+typedef struct aname {
+  SYMBOL *name;             /* NULL for a free slot */
+  uint64_t hash;            /* Hash value of the string */
+  int atom;
+  int piece;                /* Number of the piece (from 0) */
+} ANAME;
+
+typedef struct amap {
+  int size;                 /* Number of slots (a power of two) */
+  ANAME *slots;
+} AMAP;
+
 /* The following routines handle a single piece: */
 
 extern ATAB *new_table(int count, int offset);
 extern ATAB *extend_table(ATAB *table, int count, int offset);
+extern void truncate_table(ATAB *table, int size);
 
 /* The following routines deal with all/several pieces: */
 
 extern ATAB *copy_table(ATAB *table);
 extern ATAB *append_table(ATAB *table1, ATAB *table2);
 extern ATAB *make_contiguous(ATAB *table);
+extern ATAB *renumber_table(ATAB *table, int count, int size, int *numbers);
+extern void free_table(ATAB *table);
 extern void initialize_other_tables(ATAB *table1, ATAB *table2);
 extern void attach_atoms_to_names(ATAB *table);
 extern void detach_atoms_from_names(ATAB *table);
@@ -84,7 +138,11 @@ extern int compare_atom_tables(ATAB *table1, ATAB *table2, int checkinput);
 extern int match_atom_tables(ATAB *table1, ATAB *table2, int checkoutput);
 extern void transfer_compute_statement(ATAB *table1, ATAB *table2);
 extern ATAB *find_atom(ATAB *table, int atom);
+extern void index_table(ATAB *table);
 extern int find_atom_by_name(ATAB *table, char *name);
+extern int find_atoms_by_names(ATAB *table, int cnt, char **names,
+			       int *atoms);
+extern void forget_names(ATAB *table);
 extern SYMBOL *find_name(ATAB *table, int atom);
 #define invisible(t,a) (!find_name(t,a))
 #define visible(t,a) find_name(t,a)
@@ -93,12 +151,19 @@ extern int set_status(ATAB *table, int atom, int mask);
 extern int set_statuses(ATAB *table, int cnt, int *atoms, int mask);
 extern int clear_status(ATAB *table, int atom, int mask);
 extern int get_status(ATAB *table, int atom);
+extern int get_piece_status(ATAB *piece, int i);
+extern void set_piece_status(ATAB *piece, int i, int mask);
+extern void clear_piece_status(ATAB *piece, int i, int mask);
+extern int count_statuses(ATAB *table, int mask, int named);
+extern void mark_named(ATAB *table, int mask);
+extern int next_status(ATAB *piece, int i, int mask);
 extern int find_invisible(ATAB *table);
 extern int table_size(ATAB* table);
 extern void set_shift(ATAB* table, int shift);
 extern void set_postfix(ATAB* table, char *postfix);
 extern void set_prefix(ATAB* table, char *prefix);
 extern int set_name(ATAB *table, int atom, char *name);
+extern int set_symbol(ATAB *table, int atom, SYMBOL *symbol);
 extern int set_module(ATAB *table, int atom, int module);
 extern int log10i(int);
 extern void name_invisible_atoms(char *prefix, ATAB *table);
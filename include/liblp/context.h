@@ -0,0 +1,106 @@
+/* liblp -- ASPTOOLS library for the Smodels file format
+
+   Copyright (C) 2022 Tomi Janhunen
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+   USA
+*/
+
+/*
+ * Definitions related to contexts (state of the library)
+ */
+
+#define _CONTEXT_H_RCSFILE  "$RCSfile: context.h,v $"
+#define _CONTEXT_H_DATE     "$Date: 2023/03/27 10:00:00 $"
+#define _CONTEXT_H_REVISION "$Revision: 1.2 $"
+
+#include <setjmp.h>
+
+extern void _version_context_c();
+
+/* The state kept by the library between calls (the largest atom number
+   and weight read, the ASPIF priority level, readers attached to
+   streams, the rule arena in use, and the symbol table) is gathered in
+   a context together with the last failure.  Each thread operates on
+   its current context; this is the default context unless another one
+   has been selected by use_context.  Threads started by run_parallel
+   inherit the context of the caller. */
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL  /* A single context per process */
+#endif
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define NORETURN _Noreturn
+#elif defined(__GNUC__)
+#define NORETURN __attribute__((noreturn))
+#else
+#define NORETURN
+#endif
+
+/* Codes of failures */
+
+#define ERROR_NONE        0
+#define ERROR_FAILED      1  /* Other failures (see error) */
+#define ERROR_SYNTAX      2  /* Malformed input */
+#define ERROR_UNSUPPORTED 3  /* Not supported by the format or style */
+#define ERROR_TABLE       4  /* Atom missing from a table */
+#define ERROR_MEMORY      5  /* Out of memory */
+
+#define ERROR_SIZE 256       /* Space for messages */
+
+struct reader;
+struct rule_arena;
+struct symbols;
+
+typedef struct context {
+  int max_atom;                   /* Largest atom number read */
+  long max_weight;                /* Largest weight read */
+  int priority;                   /* Priority level for ASPIF translation */
+  struct reader *readers;         /* Readers attached to streams */
+  struct rule_arena *rule_arena;  /* Where rules are allocated (if any) */
+  struct symbols *symbols;        /* Symbol table (created when needed) */
+  int error;                      /* Code of the last failure */
+  long offset;                    /* Its byte offset in the input (or -1) */
+  int line;                       /* Its line in the input (or 0) */
+  char message[ERROR_SIZE];       /* Its description */
+} CONTEXT;
+
+extern THREAD_LOCAL CONTEXT *current_context;
+
+extern CONTEXT *new_context();
+extern CONTEXT *use_context(CONTEXT *context);
+extern void free_context(CONTEXT *context);
+
+/* Failures are recorded in the current context and passed to the point
+   set by catch_errors in the calling thread (if any); otherwise the
+   message is printed and the program exits */
+
+extern jmp_buf *catch_errors(jmp_buf *abort);
+extern NORETURN void failure(int code, char *format, ...);
+extern NORETURN void failure_at(int code, long offset, int line,
+				char *format, ...);
+extern NORETURN void raise_failure();
+
+/* Failures within jobs run by run_parallel are recorded apart from the
+   shared context and passed on once all jobs have finished; the record
+   of the calling thread is set by record_failures (NULL: the current
+   context) which returns the previous one */
+
+extern CONTEXT *record_failures(CONTEXT *record);
@@ -25,8 +25,8 @@
  */
 
 #define _IO_H_RCSFILE  "$RCSfile: io.h,v $"
-#define _IO_H_DATE     "$Date: 2023/02/25 13:28:28 $"
-#define _IO_H_REVISION "$Revision: 1.15 $"
+#define _IO_H_DATE     "$Date: 2023/03/27 10:00:00 $"
+#define _IO_H_REVISION "$Revision: 1.16 $"
 
 extern void _version_input_c();
 extern void _version_output_c();
@@ -38,16 +38,23 @@ extern void _version_input_c();
 extern char *program_name;
 extern void error(char *msg);
 extern char *read_string(FILE *in);
+extern int map_input(FILE *in);
+extern void unmap_input(FILE *in);
 
 extern void initialize_program();
 extern RULE *read_rule(FILE *in);
+extern RULE *read_rule_reusing(FILE *in, RULE_ARENA *buffer);
 extern RULE *read_program(FILE *in);
+extern RTAB *read_program_rtab(FILE *in);
 extern ATAB *read_symbols(FILE *in);
 extern int read_compute_statement(FILE *in, ATAB *table);
+extern ATAB *convert_program(int style, FILE *in, FILE *out);
 
 extern ATAB *initialize_cnf(FILE *in, int *clauses, int *weighted);
 extern RULE *read_clause(FILE *in, int weighted);
+extern RULE *read_clause_reusing(FILE *in, int weighted, RULE_ARENA *buffer);
 extern RULE *read_cnf(FILE *in, ATAB **table, int *weighted);
+extern RTAB *read_cnf_rtab(FILE *in, ATAB **table, int *weighted);
 
 /* Declarations related with output.c */
 
@@ -74,6 +81,8 @@ extern void write_clause_as_rule(int style, FILE *out,
 				 int contradiction, ATAB *table2);
 extern void write_rule(int style, FILE *out, RULE *rule, ATAB *table);
 extern void write_program(int style, FILE *out, RULE *program, ATAB *table);
+extern void write_program_rtab(int style, FILE *out, RTAB *rules,
+			       ATAB *table);
 extern void write_status(FILE *out, int flags);
 
 extern void write_symbols(int style, FILE *out, ATAB *table);
@@ -86,8 +95,39 @@ extern void write_classical_atom(int style, FILE *out, int atom,
 extern void write_other_classical_atom(int style, FILE *out, int atom,
 				       ATAB *table);
 extern void write_cnf(int style, FILE *out, RULE *cnf, ATAB *table);
+extern void write_cnf_rtab(int style, FILE *out, RTAB *cnf, ATAB *table);
 
 extern void free_rule(RULE *rule);
 extern void free_program(RULE *program);
 
-extern long max_weight;
+extern long get_max_weight();  /* Largest weight read (if any) */
+extern long max_weight;        /* Obsolete: see input.c */
+
+/* Variants operating on a given context (see context.h) */
+
+struct context;
+
+extern RULE *read_program_ctx(struct context *context, FILE *in);
+extern ATAB *read_symbols_ctx(struct context *context, FILE *in);
+extern int read_compute_statement_ctx(struct context *context, FILE *in,
+				      ATAB *table);
+extern RULE *read_cnf_ctx(struct context *context, FILE *in, ATAB **table,
+			  int *weighted);
+extern void write_program_ctx(struct context *context, int style, FILE *out,
+			      RULE *program, ATAB *table);
+extern void release_readers();
+
+/* Variants returning the code of a failure rather than exiting (see
+   context.h); others may be wrapped likewise using catch_errors */
+
+extern int read_program_status(FILE *in, RULE **program);
+extern int read_symbols_status(FILE *in, ATAB **table);
+extern int read_compute_statement_status(FILE *in, ATAB *table, int *number);
+extern int read_cnf_status(FILE *in, ATAB **table, int *weighted,
+			   RULE **cnf);
+extern int write_program_status(int style, FILE *out, RULE *program,
+				ATAB *table);
+extern int write_symbols_status(int style, FILE *out, ATAB *table);
+extern int write_compute_statement_status(int style, FILE *out, ATAB *table,
+					  int mask);
+extern int write_cnf_status(int style, FILE *out, RULE *cnf, ATAB *table);
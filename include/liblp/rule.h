@@ -128,10 +128,90 @@ typedef union any_rule {
 
 typedef struct rule {
   int type;
+  int arena;                /* RULE_IN_ARENA: not for free_rule */
   ANY_RULE data;
   struct rule *next;
 } RULE;
 
+/* Only this value of arena keeps free_rule from releasing a rule: the
+   library sets it for rules in arenas and for views (see view_rule), so
+   rules built by clients with malloc may leave the field unset */
+
+#define RULE_IN_ARENA 0x41524e41
+
+/* Rules may be allocated from an arena and released all at once */
+
+typedef struct rule_block {
+  char *free;               /* Free space in this block */
+  char *end;                /* End of this block */
+  struct rule_block *next;  /* Other blocks */
+} RULE_BLOCK;
+
+typedef struct rule_arena {
+  RULE_BLOCK *blocks;       /* The first block is in use */
+} RULE_ARENA;
+
+extern RULE_ARENA *get_rule_arena();  /* Current arena (NULL: use malloc) */
+
+/* Storage for the type-specific part of a rule (see view_rule) */
+
+typedef union rule_data {
+  BASIC_RULE basic;
+  CONSTRAINT_RULE constraint;
+  CHOICE_RULE choice;
+  INTEGRITY_RULE integrity;
+  WEIGHT_RULE weight;
+  OPTIMIZE_RULE optimize;
+  DISJUNCTIVE_RULE disjunctive;
+  CLAUSE clause;
+} RULE_DATA;
+
+/* Rules stored in contiguous arrays (an alternative to RULE lists): the
+   literals of the i-th rule are in the pool starting from starts[i] in
+   the order <heads> <negative> <positive> <weights> where weights are
+   present for weight rules and optimize statements only */
+
+typedef struct rtab {
+  long count;          /* Number of rules */
+  long size;           /* Space reserved for rules */
+  int *types;          /* Rule types */
+  long *starts;        /* Position of the first literal in the pool */
+  int *head_cnts;      /* Number of head atoms */
+  int *neg_cnts;       /* Number of negative literals */
+  int *pos_cnts;       /* Number of positive literals */
+  long *bounds;        /* Bounds of constraint and weight rules and
+			  weights of clauses */
+  long used;           /* Used part of the pool */
+  long pool_size;
+  int *pool;           /* Literals and weights of all rules */
+} RTAB;
+
+#define RTAB_HEADS(t, i) (&((t)->pool)[((t)->starts)[i]])
+#define RTAB_NEG(t, i) (RTAB_HEADS(t, i) + ((t)->head_cnts)[i])
+#define RTAB_POS(t, i) (RTAB_NEG(t, i) + ((t)->neg_cnts)[i])
+#define RTAB_WEIGHTS(t, i) (RTAB_POS(t, i) + ((t)->pos_cnts)[i])
+
+/* Occurrences of atoms in rules (in CSR form): the numbers of the rules
+   where atom a occurs in a head (k = OCC_HEAD), in a positive body
+   (OCC_POS), or in a negative body (OCC_NEG) are listed in ascending
+   order at occs[k][starts[k][a]], ..., occs[k][starts[k][a+1]-1] */
+
+#define OCC_HEAD 0
+#define OCC_POS  1
+#define OCC_NEG  2
+
+typedef struct otab {
+  int atoms;           /* Atoms 1, ..., atoms are covered */
+  int count;           /* Number of rules */
+  RULE **rules;        /* Rules by number (NULL for an RTAB) */
+  int *starts[3];      /* Start of the list of each atom (see above) */
+  int *occs[3];        /* Rule numbers */
+} OTAB;
+
+#define OTAB_CNT(o, k, a) \
+  (((o)->starts[k])[(a)+1] - ((o)->starts[k])[a])
+#define OTAB_RULES(o, k, a) (&((o)->occs[k])[((o)->starts[k])[a]])
+
 extern void _version_rule_c();
 
 extern int get_head(RULE *r);
@@ -141,6 +221,8 @@ extern int *get_pos(RULE *r);
 extern int get_pos_cnt(RULE *r);
 extern int *get_neg(RULE *r);
 extern int get_neg_cnt(RULE *r);
+extern int *get_weights(RULE *rule);
+extern long get_bound(RULE *rule);
 
 extern int check_negative_invisible(RULE *program, ATAB* table);
 extern void mark_io_atoms(RULE *program, ATAB *table, int module);
@@ -156,3 +238,41 @@ extern int compute_statement_len(ATAB *table);
 extern int number_of_rules(RULE *program);
 extern RULE *append_rules(RULE *program, RULE *rules);
 extern RULE *copy_rule(RULE *rule);
+
+extern RULE_ARENA *new_rule_arena();
+extern RULE_ARENA *use_rule_arena(RULE_ARENA *arena);
+extern void *arena_alloc(RULE_ARENA *arena, size_t size);
+extern void *rule_alloc(size_t size);
+extern void reset_rule_arena(RULE_ARENA *arena);
+extern void merge_rule_arenas(RULE_ARENA *arena1, RULE_ARENA *arena2);
+extern void free_rule_arena(RULE_ARENA *arena);
+
+extern RTAB *new_rtab(long size, long pool_size);
+extern void free_rtab(RTAB *rules);
+extern void grow_rtab(RTAB *rules, long pool_needed);
+extern long put_rtab(RTAB *rules, int type, int head_cnt, int neg_cnt,
+		     int pos_cnt, long bound);
+extern long add_rtab(RTAB *rules, int type, int head_cnt, int *heads,
+		     int neg_cnt, int *neg, int pos_cnt, int *pos,
+		     int *weights, long bound);
+extern long add_rule_to_rtab(RTAB *rules, RULE *rule);
+extern void append_rtab(RTAB *rules1, RTAB *rules2);
+extern RTAB *program_to_rtab(RULE *program);
+extern RULE *view_rule(RTAB *rules, long i, RULE *view, RULE_DATA *data);
+extern RULE *rtab_to_program(RTAB *rules);
+extern int check_negative_invisible_rtab(RTAB *rules, ATAB *table);
+extern void mark_io_atoms_rtab(RTAB *rules, ATAB *table, int module);
+extern void mark_occurrences_rtab(RTAB *rules, ATAB *table);
+extern int len_rtab(RTAB *rules);
+
+extern OTAB *index_occurrences(RULE *program);
+extern OTAB *index_occurrences_rtab(RTAB *rules);
+extern void free_otab(OTAB *occurrences);
+
+/* Orders of atoms for renumber_atoms */
+
+#define ORDER_BY_NUMBER     0  /* Preserve the relative order */
+#define ORDER_BY_OCCURRENCE 1  /* First occurrences in rules */
+#define ORDER_BY_DEPENDENCY 2  /* Bodies before heads (depth-first) */
+
+extern ATAB *renumber_atoms(RULE *program, ATAB *table, int order);
@@ -0,0 +1,63 @@
+/* liblp -- ASPTOOLS library for the Smodels file format
+
+   Copyright (C) 2022 Tomi Janhunen
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+   USA
+*/
+
+/*
+ * Definitions related to binary snapshots of programs
+ */
+
+#define _SNAPSHOT_H_RCSFILE  "$RCSfile: snapshot.h,v $"
+#define _SNAPSHOT_H_DATE     "$Date: 2023/04/10 10:00:00 $"
+#define _SNAPSHOT_H_REVISION "$Revision: 1.1 $"
+
+extern void _version_snapshot_c();
+
+/* A snapshot stores the rules (as an RTAB), the atom table with names
+   and statuses (hence the compute statement and the input atoms), and
+   the number of models in a binary form that is loaded without parsing.
+   Snapshots are meant as caches: they are read on machines with the
+   same byte order and sizes of int and long as the writer.  Prefixes,
+   postfixes, and cross-references of tables are not stored. */
+
+#define SNAPSHOT_VERSION 2
+
+/* A loaded snapshot: the rules are a read-only view of the file (they
+   must not be extended or freed with free_rtab; see rtab_to_program for
+   a copy) whereas the table is an ordinary one owned by the caller */
+
+typedef struct snapshot {
+  char *data;          /* Contents of the snapshot */
+  long size;           /* Its size in bytes */
+  char *map;           /* Mapping of the file (NULL if data is copied) */
+  size_t map_size;
+  RTAB rules;          /* Rules (a view of data) */
+  ATAB *table;         /* Atoms (see free_table) */
+  int number;          /* Number of models (see read_compute_statement) */
+} SNAPSHOT;
+
+extern void write_snapshot(FILE *out, RULE *program, ATAB *table,
+			   int number);
+extern void write_snapshot_rtab(FILE *out, RTAB *rules, ATAB *table,
+				int number);
+extern SNAPSHOT *read_snapshot(FILE *in, int verify);
+extern void free_snapshot(SNAPSHOT *snapshot);
+
+extern int write_snapshot_status(FILE *out, RULE *program, ATAB *table,
+				 int number);
+extern int read_snapshot_status(FILE *in, int verify, SNAPSHOT **snapshot);
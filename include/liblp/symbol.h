@@ -32,6 +32,9 @@
 #define _SYMBOL_H_DATE     "$Date: 2021/05/27 08:50:04 $"
 #define _SYMBOL_H_REVISION "$Revision: 1.4 $"
 
+#include <stdint.h>
+#include <stddef.h>
+
 extern void _version_symbol_c();
 
 typedef struct info {
@@ -42,11 +45,31 @@ typedef struct info {
 
 typedef struct symbol {
   char *name;          /* String */
+  int length;          /* Length of the string */
+  int split;           /* Position of the first '(' (or the length) */
   INFO info;           /* Data associated with this symbol (if any) */
-  struct symbol *next; /* Next entry */
+  struct symbol *next; /* Next entry (not used by the hash table) */
 } SYMBOL;
 
 extern void symbol_table_init();
+extern void symbol_table_free();
 extern SYMBOL *make_symbol(char *);
 extern void print_symbol(FILE *out, SYMBOL *);
 extern SYMBOL *find_symbol(char *name);
+extern SYMBOL *lookup_name(char *name);
+extern SYMBOL *find_shared_symbol(char *name);
+extern void keep_mapping(void *map, size_t size);
+extern uint64_t hash(char *name, size_t len);
+
+/* The symbol table of a context is used by one thread at a time unless
+   concurrent interning is turned on by concurrent_symbols(-1); then the
+   shards of the table are locked on each use.  The library turns it on
+   for its own parallel jobs, but clients interning names (find_symbol
+   etc.) from several threads at once must turn it on beforehand.  The
+   mode must not be changed while other threads use the table. */
+
+extern int concurrent_symbols(int mode);
+
+struct context;
+
+extern SYMBOL *find_symbol_ctx(struct context *context, char *name);
@@ -0,0 +1,61 @@
+/* liblp -- ASPTOOLS library for the Smodels file format
+
+   Copyright (C) 2022 Tomi Janhunen
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+   USA
+*/
+
+/*
+ * Definitions related to worker threads
+ */
+
+#define _THREAD_H_RCSFILE  "$RCSfile: thread.h,v $"
+#define _THREAD_H_DATE     "$Date: 2023/04/03 10:00:00 $"
+#define _THREAD_H_REVISION "$Revision: 1.2 $"
+
+extern void _version_thread_c();
+
+extern int worker_threads;  /* Number of threads (1 = sequential) */
+
+extern void run_parallel(int jobs, void (*job)(void *data, int index),
+			 void *data);
+
+typedef struct lock LOCK;  /* Mutual exclusion (no-op without threads) */
+
+extern LOCK *new_lock();
+extern void acquire(LOCK *lock);
+extern void release(LOCK *lock);
+extern LOCK *lock_once(LOCK **lock);
+extern void free_lock(LOCK *lock);
+
+/* Atomic increment of an int returning its previous value, and atomic
+   compare-and-swap returning non-zero on success; left undefined if the
+   compiler offers no support (callers then stay with a single thread) */
+
+#ifdef __GNUC__
+#define ATOMIC_INCREMENT(p) __sync_fetch_and_add((p), 1)
+#define ATOMIC_CAS(p, old, new) __sync_bool_compare_and_swap((p), (old), (new))
+#endif
+
+/* Loads and stores of pointers published to other threads */
+
+#ifdef __GNUC__
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+#define ATOMIC_LOAD(p) (*(p))
+#define ATOMIC_STORE(p, v) (*(p) = (v))
+#endif
@@ -33,6 +33,8 @@
 #include "atom.h"
 #include "rule.h"
 #include "io.h"
+#include "thread.h"
+#include "context.h"
 
 /* --------------------- Print version information ------------------------- */
 
@@ -49,13 +51,163 @@ void _version_atom_c()
 	   "$Revision: 1.19 $");
 }
 
+/* ----------------------------- Status bits ------------------------------ */
+
+#define WORD(i) ((i) >> 6)
+#define BIT(i)  ((uint64_t)1 << ((i) & 63))
+
+/* The index of the lowest bit set in a nonzero word */
+
+int lowest_bit(uint64_t bits)
+{
+#ifdef __GNUC__
+  return __builtin_ctzll(bits);
+#else
+  int i = 0;
+
+  while(!(bits & 1)) {
+    bits >>= 1;
+    i++;
+  }
+
+  return i;
+#endif
+}
+
+ASTATUS *new_statuses(int count)
+{
+  ASTATUS *statuses = (ASTATUS *)malloc(sizeof(ASTATUS));
+  int k = 0;
+
+  if(!statuses)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  statuses->words = WORD(count)+1;
+  for(k=0; k<STATUS_FLAGS; k++)
+    (statuses->bits)[k] = NULL;
+
+  return statuses;
+}
+
+void free_statuses(ASTATUS *statuses)
+{
+  int k = 0;
+
+  for(k=0; k<STATUS_FLAGS; k++)
+    if((statuses->bits)[k])
+      free((statuses->bits)[k]);
+  free(statuses);
+
+  return;
+}
+
+/* The bitset of the k-th flag (allocated when needed) */
+
+uint64_t *status_bits(ASTATUS *statuses, int k)
+{
+  uint64_t *bits = (statuses->bits)[k];
+
+  if(!bits) {
+    bits = (uint64_t *)calloc(statuses->words, sizeof(uint64_t));
+    if(!bits)
+      failure(ERROR_MEMORY, "out of memory!");
+    (statuses->bits)[k] = bits;
+  }
+
+  return bits;
+}
+
+/* The first index j >= i of a bitset with the bit set (or count+1) */
+
+int next_bit(uint64_t *bits, int i, int count)
+{
+  while(i <= count) {
+    uint64_t word = bits[WORD(i)] >> (i & 63);
+
+    if(word) {
+      i += lowest_bit(word);
+      break;
+    }
+    i = (WORD(i)+1) << 6;
+  }
+
+  return i <= count ? i : count+1;
+}
+
+/* Move the status bits of a piece to index numbers[i+shift] (if numbers
+   is given and i+shift <= size) or i+shift of another piece; the bits of
+   the first piece are released */
+
+void move_statuses(ATAB *from, ATAB *to, int shift, int *numbers, int size)
+{
+  ASTATUS *statuses = from->statuses;
+  int count = from->count;
+  int k = 0;
+
+  for(k=0; k<STATUS_FLAGS; k++) {
+    uint64_t *bits = (statuses->bits)[k];
+    int i = 0;
+
+    if(!bits)
+      continue;
+
+    for(i=next_bit(bits, 1, count); i<=count; i=next_bit(bits, i+1, count)) {
+      int j = i+shift;
+
+      if(numbers)
+	j = j <= size ? numbers[j] : 0;
+      if(j)
+	status_bits(to->statuses, k)[WORD(j)] |= BIT(j);
+    }
+  }
+  free_statuses(statuses);
+  from->statuses = NULL;
+
+  return;
+}
+
+int get_piece_status(ATAB *piece, int i)
+{
+  ASTATUS *statuses = piece->statuses;
+  int status = 0;
+  int k = 0;
+
+  for(k=0; k<STATUS_FLAGS; k++)
+    if((statuses->bits)[k] && ((statuses->bits)[k][WORD(i)] & BIT(i)))
+      status |= 1 << k;
+
+  return status;
+}
+
+void set_piece_status(ATAB *piece, int i, int mask)
+{
+  int k = 0;
+
+  for(k=0; k<STATUS_FLAGS; k++)
+    if(mask & (1 << k))
+      status_bits(piece->statuses, k)[WORD(i)] |= BIT(i);
+
+  return;
+}
+
+void clear_piece_status(ATAB *piece, int i, int mask)
+{
+  ASTATUS *statuses = piece->statuses;
+  int k = 0;
+
+  for(k=0; k<STATUS_FLAGS; k++)
+    if((mask & (1 << k)) && (statuses->bits)[k])
+      (statuses->bits)[k][WORD(i)] &= ~BIT(i);
+
+  return;
+}
+
 /* ------------------------ Handling atom tables --------------------------- */
 
 ATAB *new_table(int count, int offset)
 {
   ATAB *table = (ATAB *)malloc(sizeof(ATAB));
   SYMBOL **names = (SYMBOL **)malloc((count+1) * sizeof(SYMBOL *));
-  int *statuses = (int *)malloc((count+1) * sizeof(int));
   int i = 0;
 
   symbol_table_init();  /* Initialize low level table */
@@ -65,25 +217,143 @@ ATAB *new_table(int count, int offset)
   table->shift = 0;
   table->prefix = NULL;
   table->postfix = NULL;
+  table->prefix_len = 0;
+  table->postfix_len = 0;
   table->other = NULL;
   table->next = NULL;
   table->last = table;  /* Defined only for the first piece */
+  table->first = table;
+  table->index = NULL;
+  table->map = NULL;
   table->names = names;
-  table->statuses = statuses;
+  table->statuses = new_statuses(count);
   table->others = NULL;
 
-  /* Clear names and status bits */
+  /* Clear names (status bits are clear) */
 
-  for(i=0; i<=count; i++) {
+  for(i=0; i<=count; i++)
     names[i] = NULL;
-    statuses[i] = 0;
-  }
 
   return table;
 }
 
 int *initialize_other_table(ATAB *table1, ATAB *table2);
 
+/* ----------------------- Index of pieces ------------------------------- */
+
+void free_index(ATAB *table)
+{
+  AINDEX *index = table->index;
+
+  if(index) {
+    free(index->pieces);
+    free(index);
+    table->index = NULL;
+  }
+
+  return;
+}
+
+int compare_pieces(const void *p1, const void *p2)
+{
+  const APIECE *piece1 = (const APIECE *)p1;
+  const APIECE *piece2 = (const APIECE *)p2;
+
+  if(piece1->low < piece2->low)
+    return -1;
+  else if(piece1->low > piece2->low)
+    return 1;
+  return 0;
+}
+
+/* Record a piece at the end of the index (possibly out of order) */
+
+void add_piece(AINDEX *index, ATAB *piece)
+{
+  APIECE *entry = NULL;
+
+  if(index->count == index->size) {
+    index->size = index->size ? 2*index->size : 8;
+    index->pieces =
+      (APIECE *)realloc(index->pieces, index->size*sizeof(APIECE));
+  }
+
+  entry = &(index->pieces)[index->count++];
+  entry->low = piece->offset;
+  entry->high = piece->offset + piece->count;
+  entry->piece = piece;
+  index->last = piece;
+
+  return;
+}
+
+/* Index the pieces of a table by atom numbers; the index is usable only
+   if the pieces do not overlap (the first piece in the list takes
+   precedence otherwise) */
+
+AINDEX *build_index(ATAB *table)
+{
+  AINDEX *index = (AINDEX *)malloc(sizeof(AINDEX));
+  ATAB *scan = table;
+  int i = 0;
+
+  index->count = 0;
+  index->size = 0;
+  index->usable = -1;
+  index->pieces = NULL;
+
+  while(scan) {
+    if(scan->count > 0)
+      add_piece(index, scan);
+    scan = scan->next;
+  }
+  index->last = table->last;
+
+  qsort(index->pieces, index->count, sizeof(APIECE), compare_pieces);
+
+  for(i=1; i<index->count; i++)
+    if((index->pieces)[i].low < (index->pieces)[i-1].high)
+      index->usable = 0;
+
+  free_index(table);
+  table->index = index;
+
+  return index;
+}
+
+/* Build the index in advance so that find_atom may be called by several
+   threads at a time */
+
+void index_table(ATAB *table)
+{
+  if(table && table->last && table->next &&
+     (!table->index || table->index->last != table->last))
+    (void) build_index(table);
+
+  return;
+}
+
+/* Keep the index up to date when a piece is added to the end */
+
+void index_piece(ATAB *table, ATAB *piece)
+{
+  AINDEX *index = table->index;
+
+  if(index) {
+    int count = index->count;
+
+    if(index->usable && piece->count > 0 &&
+       (count == 0 || piece->offset >= (index->pieces)[count-1].high)) {
+      add_piece(index, piece);
+    } else if(piece->count > 0)
+      free_index(table);  /* Rebuilt when needed */
+    else
+      index->last = piece;
+  }
+
+  return;
+}
+
 ATAB *extend_table(ATAB *table, int count, int offset)
 {
   ATAB *extension = new_table(count, offset);
@@ -92,6 +362,8 @@ ATAB *extend_table(ATAB *table, int count, int offset)
   extension->shift = table->shift;
   extension->prefix = table->prefix;
   extension->postfix = table->postfix;
+  extension->prefix_len = table->prefix_len;
+  extension->postfix_len = table->postfix_len;
   if(table->other)
     initialize_other_table(extension, table->other);
 
@@ -100,10 +372,28 @@ ATAB *extend_table(ATAB *table, int count, int offset)
   last->next = extension;
   table->last = extension;
   extension->last = NULL;
+  extension->first = table;
+  index_piece(table, extension);
+  forget_names(table);
 
   return extension;
 }
 
+/* Drop the atoms beyond size from the last piece of a table (if the
+   piece extends beyond size) */
+
+void truncate_table(ATAB *table, int size)
+{
+  ATAB *last = table->last;
+
+  if(size > last->offset && size < last->offset+last->count) {
+    last->count = size-last->offset;
+    free_index(table);  /* Rebuilt when needed */
+  }
+
+  return;
+}
+
 ATAB *copy_table(ATAB *table)
 {
   ATAB *copy = (ATAB *)malloc(sizeof(ATAB));
@@ -118,8 +408,13 @@ ATAB *copy_table(ATAB *table)
     copy->shift = table->shift;
     copy->prefix = table->prefix;
     copy->postfix = table->postfix;
+    copy->prefix_len = table->prefix_len;
+    copy->postfix_len = table->postfix_len;
     copy->other = table->other;
     copy->last = NULL;
+    copy->first = first;
+    copy->index = NULL;
+    copy->map = NULL;
     copy->names = table->names;
     copy->statuses = table->statuses;
     copy->others = table->others;
@@ -140,10 +435,18 @@ ATAB *append_table(ATAB *table1, ATAB *table2)
 {
   if(table1) {
     ATAB *last = table1->last;
+    ATAB *scan = table2;
+
+    free_index(table1);  /* Rebuilt when needed */
+    free_index(table2);
+    forget_names(table1);
+    forget_names(table2);
 
     last->next = table2;
     table1->last = table2->last;
     table2->last = NULL;
+    for(; scan; scan = scan->next)
+      scan->first = table1;
 
   } else
     table1 = table2;
@@ -163,7 +466,11 @@ ATAB *make_contiguous(ATAB *table)
   new->shift = table->shift;
   new->prefix = table->prefix;
   new->postfix = table->postfix;
+  new->prefix_len = table->prefix_len;
+  new->postfix_len = table->postfix_len;
   new->other = table->other;
+  free_index(table);
+  forget_names(table);
 
   if(scan->others) {
     new->others = (int *)malloc((size-offset+1)*sizeof(int));
@@ -181,13 +488,87 @@ ATAB *make_contiguous(ATAB *table)
     for(i=1; i<=count2; i++) {
 
       (new->names)[i+offset2] = (scan->names)[i];
-      (new->statuses)[i+offset2] = (scan->statuses)[i];
       if(scan->others)
 	(new->others)[i+offset2] = (scan->others)[i];
     }
+    move_statuses(scan, new, offset2, NULL, 0);
+
+    free(scan->names);
+    if(scan->others)
+      free(scan->others);
+    free(scan);
+
+    scan = next;
+  }
+
+  return new;
+}
+
+/* Release a table with all of its pieces (the symbols remain) */
+
+void free_table(ATAB *table)
+{
+  free_index(table);
+  forget_names(table);
+
+  while(table) {
+    ATAB *next = table->next;
+
+    free(table->names);
+    free_statuses(table->statuses);
+    if(table->others)
+      free(table->others);
+    free(table);
+
+    table = next;
+  }
+
+  return;
+}
+
+/* Renumber the atoms of a table: atom a becomes numbers[a] (for a <=
+   size) and is dropped if numbers[a] is zero; the result is a contiguous
+   table of count atoms that replaces the original one */
+
+ATAB *renumber_table(ATAB *table, int count, int size, int *numbers)
+{
+  ATAB *new = new_table(count, 0);
+  ATAB *scan = table;
+  int i = 0;
+
+  new->shift = table->shift;
+  new->prefix = table->prefix;
+  new->postfix = table->postfix;
+  new->prefix_len = table->prefix_len;
+  new->postfix_len = table->postfix_len;
+  new->other = table->other;
+  free_index(table);
+  forget_names(table);
+
+  if(scan->others) {
+    new->others = (int *)malloc((count+1)*sizeof(int));
+
+    for(i=0; i<=count; i++)
+      (new->others)[i] = 0;
+  }
+
+  while(scan) {
+    ATAB *next = scan->next;
+    int count2 = scan->count;
+    int offset2 = scan->offset;
+
+    for(i=1; i<=count2 && i+offset2<=size; i++) {
+      int atom = numbers[i+offset2];
+
+      if(atom) {
+	(new->names)[atom] = (scan->names)[i];
+	if(scan->others && new->others)
+	  (new->others)[atom] = (scan->others)[i];
+      }
+    }
+    move_statuses(scan, new, offset2, numbers, size);
 
     free(scan->names);
-    free(scan->statuses);
     if(scan->others)
       free(scan->others);
     free(scan);
@@ -302,16 +683,16 @@ int combine_atom_tables(ATAB *table1, ATAB *table2,
 	  (scan->others)[i] = sym->info.atom;
 
 	  if(checkinput) {
-	    int status1 = (scan->statuses)[i];
-	    int status2 = (other->statuses)[j];
+	    int status1 = get_piece_status(scan, i);
+	    int status2 = get_piece_status(other, j);
 
 	    if((status1 & MARK_INPUT) && !(status2 & MARK_INPUT))
 	      return i+(scan->offset);
 	  }
 
 	  if(checkoutput) {
-	    int status1 = (scan->statuses)[i];
-	    int status2 = (other->statuses)[j];
+	    int status1 = get_piece_status(scan, i);
+	    int status2 = get_piece_status(other, j);
 
 	    /* Report atoms that are defined by both programs */
 
@@ -321,10 +702,10 @@ int combine_atom_tables(ATAB *table1, ATAB *table2,
 	    /* Clear input atoms that get defined by the other program */
 
 	    if((status1 & MARK_INPUT) && !(status2 & MARK_INPUT))
-	      (scan->statuses[i]) &= ~MARK_INPUT;
+	      clear_piece_status(scan, i, MARK_INPUT);
 
 	    if(!(status1 & MARK_INPUT) && (status2 & MARK_INPUT))
-	      (other->statuses[j]) &= ~MARK_INPUT;
+	      clear_piece_status(other, j, MARK_INPUT);
 
 	  }
 
@@ -397,8 +778,8 @@ void transfer_compute_statement(ATAB *table1, ATAB *table2)
 	if(atom2 && other) {
 	  int j = atom2 - other->offset;  /* Calculate index */
 
-	  (other->statuses)[j] |=
-	    ((scan->statuses)[i] & MARK_TRUE_OR_FALSE);
+	  set_piece_status(other, j,
+			   get_piece_status(scan, i) & MARK_TRUE_OR_FALSE);
 
 	}
       }
@@ -413,29 +794,53 @@ void transfer_compute_statement(ATAB *table1, ATAB *table2)
 
 int set_status_by_name(ATAB *table, char *name, int mask)
 {
-  while(table) {
-    int count = table->count;
-    SYMBOL **names = table->names;
-    int *statuses = table->statuses;
-    int i = 0;
+  int atom = 0;
 
-    for(i=1; i<=count; i++) {
-      SYMBOL *s = names[i];
-      if(s && strcmp(s->name, name) == 0) {
-	statuses[i] |= mask;
-	return -1;
-      }
-    }
+  if(find_atoms_by_names(table, 1, &name, &atom))
+    return set_status(table, atom, mask);
 
-    table = table->next;
-  }
   return 0;
 }
 
-/* Find the piece in which atom is stored */
+/* Find the piece in which atom is stored; the pieces of the whole table
+   (given by the first piece) are searched using an index */
 
 ATAB *find_atom(ATAB *table, int atom)
 {
+  if(!table)
+    return NULL;
+
+  if(atom > table->offset && atom <= table->offset+table->count)
+    return table;
+
+  if(table->last && table->next) {
+    AINDEX *index = table->index;
+
+    if(!index || index->last != table->last)
+      index = build_index(table);
+
+    if(index->usable) {
+      APIECE *pieces = index->pieces;
+      int low = 0;
+      int high = index->count-1;
+
+      /* Binary search for the last piece with low < atom */
+
+      while(low <= high) {
+	int middle = low + (high-low)/2;
+
+	if(pieces[middle].low < atom)
+	  low = middle+1;
+	else
+	  high = middle-1;
+      }
+
+      if(high >= 0 && atom <= pieces[high].high)
+	return pieces[high].piece;
+      return NULL;
+    }
+  }
+
   while(table) {
     int count = table->count;
     int offset = table->offset;
@@ -448,20 +853,132 @@ ATAB *find_atom(ATAB *table, int atom)
 
 int find_atom_by_name(ATAB *table, char *name)
 {
-  while(table) {
-    int count = table->count;
-    int offset = table->offset;
-    SYMBOL **names = table->names;
-    int i = 0;
+  int atom = 0;
 
-    for(i=1; i<=count; i++) {
-      SYMBOL *s = names[i];
-      if(s && strcmp(s->name, name) == 0)
-	return i+offset;
+  (void) find_atoms_by_names(table, 1, &name, &atom);
+
+  return atom;
+}
+
+/* ------------------------ Map names to atoms ----------------------------- */
+
+/* The reverse map of a table is kept in its first piece; it is created
+   on demand and dropped whenever names may change (set_name, set_symbol,
+   extend_table, etc.); code that assigns names[] directly should call
+   forget_names for the table (or any of its pieces).  Names are compared
+   as strings (symbols need not come from the current symbol table) and
+   every occurrence of a name is kept: occurrences are probed in the
+   order of the pieces, which allows searches from any piece onward */
+
+void forget_names(ATAB *table)
+{
+  ATAB *first = table ? table->first : NULL;
+  AMAP *map = first ? first->map : NULL;
+
+  if(map) {
+    free(map->slots);
+    free(map);
+    first->map = NULL;
+  }
+
+  return;
+}
+
+AMAP *map_names(ATAB *table)
+{
+  AMAP *map = (AMAP *)malloc(sizeof(AMAP));
+  ATAB *scan = table;
+  int named = 0;
+  int piece = 0;
+  int mask = 0;
+  int i = 0;
+
+  while(scan) {
+    SYMBOL **names = scan->names;
+
+    for(i=1; i<=scan->count; i++)
+      if(names[i])
+	named++;
+    scan = scan->next;
+  }
+
+  map->size = 16;
+  while(map->size < 2*named)
+    map->size *= 2;
+  map->slots = (ANAME *)calloc(map->size, sizeof(ANAME));
+  mask = map->size-1;
+
+  for(scan = table; scan; scan = scan->next, piece++) {
+    SYMBOL **names = scan->names;
+    int offset = scan->offset;
+
+    for(i=1; i<=scan->count; i++) {
+      SYMBOL *name = names[i];
+
+      if(name) {
+	uint64_t h = hash(name->name, strlen(name->name));
+	size_t j = h & mask;
+
+	while((map->slots)[j].name)
+	  j = (j+1) & mask;
+
+	(map->slots)[j].name = name;
+	(map->slots)[j].hash = h;
+	(map->slots)[j].atom = i+offset;
+	(map->slots)[j].piece = piece;
+      }
     }
-    table = table->next;
   }
-  return 0;
+
+  table->map = map;
+
+  return map;
+}
+
+/* Resolve cnt names to atoms (0 if not found) in the pieces from the
+   given one onward; the number of names found is returned */
+
+int find_atoms_by_names(ATAB *table, int cnt, char **names, int *atoms)
+{
+  ATAB *first = table ? table->first : NULL;
+  ATAB *scan = first;
+  AMAP *map = NULL;
+  int found = 0;
+  int piece = 0;
+  int mask = 0;
+  int i = 0;
+
+  if(!first)
+    return 0;
+
+  if(!(map = first->map))
+    map = map_names(first);
+  mask = map->size-1;
+
+  while(scan && scan != table) {  /* The first occurrence may precede */
+    scan = scan->next;
+    piece++;
+  }
+
+  for(i=0; i<cnt; i++) {
+    uint64_t h = hash(names[i], strlen(names[i]));
+    size_t j = h & mask;
+    ANAME *slot = NULL;
+
+    atoms[i] = 0;
+
+    while((slot = &(map->slots)[j])->name) {
+      if(slot->hash == h && slot->piece >= piece &&
+	 strcmp(slot->name->name, names[i]) == 0) {
+	atoms[i] = slot->atom;
+	found++;
+	break;
+      }
+      j = (j+1) & mask;
+    }
+  }
+
+  return found;
 }
 
 SYMBOL *find_name(ATAB *table, int atom)
@@ -481,10 +998,7 @@ int set_status(ATAB *table, int atom, int mask)
   ATAB *piece = find_atom(table, atom);
 
   if(piece) {
-    int *statuses = piece->statuses;
-    int offset = piece->offset;
-
-    statuses[atom-offset] |= mask;
+    set_piece_status(piece, atom-piece->offset, mask);
     return -1;
   }
 
@@ -506,10 +1020,7 @@ int clear_status(ATAB *table, int atom, int mask)
   ATAB *piece = find_atom(table, atom);
 
   if(piece) {
-    int *statuses = piece->statuses;
-    int offset = piece->offset;
-
-    statuses[atom-offset] &= ~mask;
+    clear_piece_status(piece, atom-piece->offset, mask);
     return -1;
   }
 
@@ -520,14 +1031,119 @@ int get_status(ATAB *table, int atom)
 {
   ATAB *piece = find_atom(table, atom);
 
-  if(piece) {
-    int *statuses = piece->statuses;
-    int offset = piece->offset;
+  if(piece)
+    return get_piece_status(piece, atom-piece->offset);
+  else
+    return -1;
+}
 
-    return statuses[atom-offset];
+/* Bulk operations on statuses work on the bitsets 64 atoms at a time */
 
-  } else
-    return -1;
+int count_bits(uint64_t bits)
+{
+#ifdef __GNUC__
+  return __builtin_popcountll(bits);
+#else
+  bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+  bits = (bits & 0x3333333333333333ULL) +
+    ((bits >> 2) & 0x3333333333333333ULL);
+  bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+
+  return (int)((bits * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* The atoms of a word of a piece having a name */
+
+uint64_t named_bits(ATAB *piece, int word)
+{
+  SYMBOL **names = piece->names;
+  int first = word << 6;
+  int last = first+63 <= piece->count ? first+63 : piece->count;
+  uint64_t bits = 0;
+  int i = 0;
+
+  for(i=first; i<=last; i++)
+    if(names[i])
+      bits |= BIT(i);
+
+  return bits;
+}
+
+/* Count the flags of mask set for atoms (having a name if named) */
+
+int count_statuses(ATAB *table, int mask, int named)
+{
+  int rvalue = 0;
+
+  while(table) {
+    ASTATUS *statuses = table->statuses;
+    int k = 0;
+    int w = 0;
+
+    for(w=0; w<statuses->words; w++) {
+      uint64_t select = named ? named_bits(table, w) : ~(uint64_t)0;
+
+      for(k=0; k<STATUS_FLAGS; k++)
+	if((mask & (1 << k)) && (statuses->bits)[k])
+	  rvalue += count_bits((statuses->bits)[k][w] & select);
+    }
+
+    table = table->next;
+  }
+
+  return rvalue;
+}
+
+/* Set the flags of mask for atoms having a name */
+
+void mark_named(ATAB *table, int mask)
+{
+  while(table) {
+    ASTATUS *statuses = table->statuses;
+    int k = 0;
+    int w = 0;
+
+    for(w=0; w<statuses->words; w++) {
+      uint64_t select = named_bits(table, w);
+
+      if(select)
+	for(k=0; k<STATUS_FLAGS; k++)
+	  if(mask & (1 << k))
+	    status_bits(statuses, k)[w] |= select;
+    }
+
+    table = table->next;
+  }
+
+  return;
+}
+
+/* The first index i, i+1, ..., of a piece having a flag of mask set (or
+   count+1); words without such flags are skipped 64 atoms at a time */
+
+int next_status(ATAB *piece, int i, int mask)
+{
+  ASTATUS *statuses = piece->statuses;
+  int count = piece->count;
+
+  while(i <= count) {
+    uint64_t word = 0;
+    int k = 0;
+
+    for(k=0; k<STATUS_FLAGS; k++)
+      if((mask & (1 << k)) && (statuses->bits)[k])
+	word |= (statuses->bits)[k][WORD(i)];
+    word >>= i & 63;
+
+    if(word) {
+      i += lowest_bit(word);
+      break;
+    }
+    i = (WORD(i)+1) << 6;
+  }
+
+  return i <= count ? i : count+1;
 }
 
 int set_name(ATAB *table, int atom, char *name)
@@ -539,6 +1155,23 @@ int set_name(ATAB *table, int atom, char *name)
     int offset = piece->offset;
 
     names[atom-offset] = find_symbol(name);
+    forget_names(table);
+    return -1;
+  }
+
+  return 0;
+}
+
+int set_symbol(ATAB *table, int atom, SYMBOL *symbol)
+{
+  ATAB *piece = find_atom(table, atom);
+
+  if(piece) {
+    SYMBOL **names = piece->names;
+    int offset = piece->offset;
+
+    names[atom-offset] = symbol;
+    forget_names(table);
     return -1;
   }
 
@@ -611,6 +1244,7 @@ void set_prefix(ATAB* table, char *prefix)
 {
   while(table) {
     table->prefix = prefix;
+    table->prefix_len = prefix ? strlen(prefix) : 0;
     table = table->next;
   }
 
@@ -621,6 +1255,7 @@ void set_postfix(ATAB* table, char *postfix)
 {
   while(table) {
     table->postfix = postfix;
+    table->postfix_len = postfix ? strlen(postfix) : 0;
     table = table->next;
   }
 
@@ -779,29 +1414,66 @@ int log10i(int number)
   return rvalue;
 }
 
+/* Atoms without names are named in ranges of pieces; large pieces are
+   split among worker threads which intern the names concurrently */
+
+#define NAME_RANGE (1<<14)  /* Smallest range worth a job */
+
+typedef struct njob {
+  ATAB *piece;
+  char *prefix;
+  int jobs;
+} NJOB;
+
+void name_range(void *data, int index)
+{
+  NJOB *job = (NJOB *)data;
+  ATAB *piece = job->piece;
+  int count = piece->count;
+  int offset = piece->offset;
+  SYMBOL **names = piece->names;
+  int first = 1 + (int)((long)count*index/job->jobs);
+  int last = (int)((long)count*(index+1)/job->jobs);
+  char *internal = (char *)malloc(strlen(job->prefix)+12);
+  int i = 0;
+
+  for(i=first; i<=last; i++)
+    if(!names[i]) {
+      sprintf(internal, "%s%i", job->prefix, i+offset);
+      names[i] = find_symbol(internal);
+    }
+
+  free(internal);
+
+  return;
+}
+
 void name_invisible_atoms(char *prefix, ATAB *table)
 {
+  NJOB job;
+
+  forget_names(table);
+  symbol_table_init();  /* Before any threads */
+
+  job.prefix = prefix;
+
   while(table) {
-    int count = table->count;
-    int offset = table->offset;
-    int shift = table->shift;
-    SYMBOL **names = table->names;
-    int *statuses = table->statuses;
-    int i = 0;
+    job.piece = table;
+    job.jobs = 1;
 
-    for(i=1; i<=count; i++) {
-      int atom = i+offset;
-      SYMBOL *name = names[i];
+    if(worker_threads > 1 && table->count >= 2*NAME_RANGE) {
+      int concurrent = concurrent_symbols(-1);
 
-      if(!name) {
-	char *internal = (char *)malloc(strlen(prefix)+log10i(atom)+1);
+      job.jobs = 4*worker_threads;
+      if(table->count/job.jobs < NAME_RANGE)
+	job.jobs = table->count/NAME_RANGE;
+      run_parallel(job.jobs, name_range, &job);
+      (void) concurrent_symbols(concurrent);
+    } else
+      name_range(&job, 0);
 
-	sprintf(internal, "%s%i", prefix, atom);
-	names[i] = find_symbol(internal);
-      }
-    }
     table = table->next;
   }
-  return;
 
+  return;
 }
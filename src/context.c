@@ -0,0 +1,193 @@
+/* liblp -- ASPTOOLS library for the Smodels file format
+
+   Copyright (C) 2022 Tomi Janhunen
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+   USA
+*/
+
+/*
+ * Contexts keeping the state of the library
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+
+#include "version.h"
+#include "symbol.h"
+#include "atom.h"
+#include "rule.h"
+#include "io.h"
+#include "context.h"
+
+/* --------------------- Print version information ------------------------- */
+
+void _version_context_h()
+{
+  _version(_CONTEXT_H_RCSFILE, _CONTEXT_H_DATE, _CONTEXT_H_REVISION);
+}
+
+void _version_context_c()
+{
+  _version_context_h();
+  _version("$RCSfile: context.c,v $",
+	   "$Date: 2023/03/27 10:00:00 $",
+	   "$Revision: 1.2 $");
+}
+
+/* ------------------------------ Contexts --------------------------------- */
+
+CONTEXT default_context = { 0, 0, 0, NULL, NULL, NULL, ERROR_NONE, -1, 0, "" };
+
+THREAD_LOCAL CONTEXT *current_context = &default_context;
+
+CONTEXT *new_context()
+{
+  CONTEXT *context = (CONTEXT *)malloc(sizeof(CONTEXT));
+
+  if(!context)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  context->max_atom = 0;
+  context->max_weight = 0;
+  context->priority = 0;
+  context->readers = NULL;
+  context->rule_arena = NULL;
+  context->symbols = NULL;
+  context->error = ERROR_NONE;
+  context->offset = -1;
+  context->line = 0;
+  context->message[0] = '\0';
+
+  return context;
+}
+
+/* Make the context current for the calling thread (NULL selects the
+   default context); the previous one is returned */
+
+CONTEXT *use_context(CONTEXT *context)
+{
+  CONTEXT *previous = current_context;
+
+  current_context = context ? context : &default_context;
+
+  return previous;
+}
+
+/* Release the readers and the symbol table of a context (symbols read in
+   the context become invalid); the rule arena is owned by the caller */
+
+void free_context(CONTEXT *context)
+{
+  CONTEXT *previous = use_context(context);
+
+  release_readers();
+  symbol_table_free();
+  (void) use_context(previous == context ? NULL : previous);
+
+  if(context != &default_context)
+    free(context);
+
+  return;
+}
+
+/* ------------------------------- Failures -------------------------------- */
+
+/* The point where failures are caught is specific to a thread so that
+   failures within jobs run by worker threads never return to the stack
+   of another thread (see run_parallel) */
+
+THREAD_LOCAL jmp_buf *error_abort = NULL;
+THREAD_LOCAL CONTEXT *error_record = NULL;  /* NULL: current context */
+
+/* Catch failures at abort (NULL: exit on failures); the previous point
+   is returned for restoring it afterwards */
+
+jmp_buf *catch_errors(jmp_buf *abort)
+{
+  jmp_buf *previous = error_abort;
+
+  error_abort = abort;
+
+  return previous;
+}
+
+CONTEXT *record_failures(CONTEXT *record)
+{
+  CONTEXT *previous = error_record;
+
+  error_record = record;
+
+  return previous;
+}
+
+/* Pass on the failure recorded last */
+
+void raise_failure()
+{
+  CONTEXT *record = error_record ? error_record : current_context;
+
+  if(error_abort)
+    longjmp(*error_abort, -1);
+
+  if(program_name)
+    fprintf(stderr, "%s: %s\n", program_name, record->message);
+  else
+    fprintf(stderr, "error: %s\n", record->message);
+  exit(-1);
+}
+
+void record_failure(int code, long offset, int line, char *format,
+		    va_list args)
+{
+  CONTEXT *record = error_record ? error_record : current_context;
+
+  record->error = code;
+  record->offset = offset;
+  record->line = line;
+  vsnprintf(record->message, ERROR_SIZE, format, args);
+
+  return;
+}
+
+void failure(int code, char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  record_failure(code, -1, 0, format, args);
+  va_end(args);
+
+  raise_failure();
+}
+
+/* As failure but with a position in the input (see input_error) */
+
+void failure_at(int code, long offset, int line, char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  record_failure(code, offset, line, format, args);
+  va_end(args);
+
+  raise_failure();
+}
@@ -24,19 +24,32 @@
  * (c) 2002-2023 Tomi Janhunen
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define MAPPED_INPUT 1
+#endif
 
 #include "version.h"
 #include "symbol.h"
 #include "atom.h"
 #include "rule.h"
 #include "io.h"
+#include "thread.h"
+#include "context.h"
 
-int max_atom = 0;
-long max_weight = 0;
 
 /* --------------------- Print version information ------------------------- */
 
@@ -57,125 +70,658 @@ void _version_input_c()
 
 char *program_name = NULL;
 
+/* The maximum weight last set in any context (for old clients; it must
+   not be used while other threads read weights) */
+
+long max_weight = 0;
+
 void error(char *msg)
 {
-  if(program_name)
-    fprintf(stderr, "%s: %s\n", program_name, msg);
+  failure(ERROR_FAILED, "%s", msg);
+}
+
+/* ------------------------- Block-buffered input -------------------------- */
+
+/* Integers and names are parsed directly from a large buffer rather
+   than through fscanf/fgetc; a reader is attached to each FILE and
+   the unread part of the buffer is given back (by seeking) as soon as
+   a complete section has been read from a seekable stream.  A regular
+   file may also be mapped as a whole (see map_input) and parsed in
+   place. */
+
+#define BUFSIZE (1<<20)
+
+#define PARTIAL_BLOCKS 4  /* Allocations per rule (see reader_alloc) */
+
+typedef struct reader {
+  FILE *file;           /* Underlying stream */
+  char *buf;            /* Buffer */
+  char *pos;            /* Next unread character */
+  char *end;            /* End of valid data */
+  long base;            /* Offset of the buffer in the stream */
+  long lines;           /* Lines discarded from a pipe buffer */
+  long names;           /* Line ends replaced by scan_name */
+  int size;             /* Size of the buffer */
+  int seekable;         /* Unread data can be given back */
+  char *map;            /* Memory-mapped file (if any) */
+  size_t map_size;      /* Size of the mapping */
+  long position;        /* Position of the stream while a map is parsed */
+  int descriptor;       /* Identity of the open file (see same_stream) */
+  dev_t device;
+  ino_t inode;
+  int detached;         /* Position handed over to the stream */
+  int resumable;        /* Continued without checks (see resume_reader) */
+  int *lits;            /* Scratch area for literals */
+  int lits_size;
+  char *copy;           /* Scratch area for names of a mapping */
+  int copy_size;
+  int *max;             /* Largest atom number (usually in the context) */
+  RULE_ARENA *arena;    /* Where rules are allocated (if not malloc) */
+  jmp_buf *abort;       /* Where to go on errors (if anywhere) */
+  ATAB *table;          /* Table under construction (freed on errors) */
+  ASTACK *missing;      /* Atoms outside the table (likewise) */
+  RTAB *rules;          /* Rules under construction (likewise) */
+  RULE *list;           /* Rules read with malloc so far (likewise) */
+  void *partial[PARTIAL_BLOCKS];  /* Blocks of the rule being read */
+  int partial_cnt;
+  struct reader *next;  /* Next reader */
+} READER;
+
+#define RGETC(r) ((r)->pos < (r)->end ? (unsigned char)*((r)->pos)++ \
+		  : fill_getc(r))
+#define RUNGETC(ch, r) ((ch) != EOF ? (void)((r)->pos)-- : (void)0)
+#define ISSPACE(ch) ((ch) == ' ' || ((ch) >= '\t' && (ch) <= '\r'))
+#define ISDIGIT(ch) ((unsigned)((ch) - '0') < 10)
+#define RALLOC(r, size) \
+  ((r)->arena ? arena_alloc((r)->arena, (size)) : reader_alloc((r), (size)))
+
+/* Allocate with malloc; the blocks of a rule are remembered until it has
+   been read (see scan_rule) so that failures do not leak them */
+
+void *reader_alloc(READER *r, size_t size)
+{
+  void *block = malloc(size);
+
+  if(r->partial_cnt < PARTIAL_BLOCKS)
+    (r->partial)[r->partial_cnt++] = block;
+
+  return block;
+}
+
+/* Release the rules left by a failure (if any) */
+
+void release_partial(READER *r)
+{
+  while(r->partial_cnt > 0)
+    free((r->partial)[--(r->partial_cnt)]);
+
+  if(r->list) {
+    free_program(r->list);
+    r->list = NULL;
+  }
+  if(r->rules) {
+    free_rtab(r->rules);
+    r->rules = NULL;
+  }
+
+  return;
+}
+
+void unlink_reader(READER *r)
+{
+  READER **scan = &(current_context->readers);
+
+  while(*scan != r)
+    scan = &((*scan)->next);
+  *scan = r->next;
+
+  return;
+}
+
+void release_reader(READER *r)
+{
+  unlink_reader(r);
+
+#ifdef MAPPED_INPUT
+  if(r->map)
+    munmap(r->map, r->map_size);
+#endif
+
+  if(!r->map)
+    free(r->buf);
+  if(r->lits)
+    free(r->lits);
+  if(r->copy)
+    free(r->copy);
+  release_partial(r);
+  free(r);
+
+  return;
+}
+
+READER *new_reader(FILE *in)
+{
+  READER *r = (READER *)malloc(sizeof(READER));
+  struct stat info;
+
+  r->file = in;
+  r->size = BUFSIZE;
+  r->buf = NULL;
+  r->pos = NULL;
+  r->end = NULL;
+  r->base = 0;
+  r->lines = 0;
+  r->names = 0;
+  r->seekable = (fseek(in, 0, SEEK_CUR) == 0);
+  r->map = NULL;
+  r->map_size = 0;
+  r->position = 0;
+  r->descriptor = fileno(in);
+  r->device = 0;
+  r->inode = 0;
+  if(fstat(r->descriptor, &info) == 0) {
+    r->device = info.st_dev;
+    r->inode = info.st_ino;
+  }
+  r->detached = 0;
+  r->resumable = 0;
+  r->lits = NULL;
+  r->lits_size = 0;
+  r->copy = NULL;
+  r->copy_size = 0;
+  r->max = &(current_context->max_atom);
+  r->arena = current_context->rule_arena;
+  r->abort = NULL;
+  r->table = NULL;
+  r->missing = NULL;
+  r->rules = NULL;
+  r->list = NULL;
+  r->partial_cnt = 0;
+  r->next = current_context->readers;
+  current_context->readers = r;
+
+  return r;
+}
+
+/* A reader retained for a stream is valid only as long as the stream
+   refers to the same open file (a FILE closed meanwhile may have been
+   reused for another one) and, if seekable, is where the reader left it
+   (the file may have been reopened or repositioned) */
+
+int same_stream(READER *r, FILE *in)
+{
+  struct stat info;
+
+  if(fileno(in) != r->descriptor ||
+     fstat(r->descriptor, &info) != 0 ||
+     info.st_dev != r->device || info.st_ino != r->inode)
+    return 0;
+
+  if(!r->seekable || r->detached)
+    return -1;
+  else if(r->map)
+    return ftell(in) == r->position;
   else
-    fprintf(stderr, "error: %s\n", msg);
-  exit(-1);
+    return ftell(in) == r->base + (long)(r->end - r->buf);
 }
 
-#define BUFSIZE 1024
+READER *attach_reader(FILE *in)
+{
+  READER *r = current_context->readers;
 
-typedef struct bufseq {
-  char *buf;
-  struct bufseq *next;
-} BUFSEQ;
+  while(r && r->file != in)
+    r = r->next;
 
-char *read_string(FILE *in)
+  /* Continue a mapped file from the current position of the stream */
+
+  if(r && r->detached) {
+    long where = ftell(in);
+
+    if(same_stream(r, in) && where >= 0 && (size_t)where <= r->map_size) {
+      r->pos = &(r->map)[where];
+      r->position = where;
+      r->detached = 0;
+    } else {
+      release_reader(r);
+      r = NULL;
+    }
+
+  /* Continue the buffer of a pipe or of a file read rule by rule */
+
+  } else if(r && !same_stream(r, in)) {
+    release_reader(r);
+    r = NULL;
+  }
+
+  if(!r) {
+    r = new_reader(in);
+    r->buf = (char *)malloc(r->size);
+    r->pos = r->buf;
+    r->end = r->buf;
+    if(r->seekable && (r->base = ftell(in)) < 0)
+      r->base = 0;
+  }
+  r->arena = current_context->rule_arena;
+  r->table = NULL;
+  r->missing = NULL;
+  r->resumable = 0;
+  release_partial(r);  /* Left by a failure */
+
+  return r;
+}
+
+void detach_reader(READER *r)
+{
+  /* Data read ahead from a pipe cannot be given back: retain the
+     reader so that the next call continues from the same buffer
+     unless nothing but white space is left before the end */
+
+  if(!r->seekable) {
+    char *scan = r->pos;
+
+    while(scan < r->end && ISSPACE(*scan))
+      scan++;
+    if(scan == r->end && feof(r->file))
+      release_reader(r);
+    return;
+  }
+
+  if(r->map) {
+    fseek(r->file, (long)(r->pos - r->map), SEEK_SET);
+    r->detached = -1;
+    return;
+  }
+
+  if(r->end != r->pos)
+    fseek(r->file, -(long)(r->end - r->pos), SEEK_CUR);
+
+  release_reader(r);
+
+  return;
+}
+
+/* Readers of single rules and clauses continue the reader of the
+   previous call without checking the stream again (which costs system
+   calls per rule); initialize_program and initialize_cnf start a new
+   sequence of calls that is checked once */
+
+READER *resume_reader(FILE *in)
+{
+  READER *r = current_context->readers;
+
+  while(r && r->file != in)
+    r = r->next;
+
+  if(r && r->resumable && !r->detached) {
+    r->arena = current_context->rule_arena;
+    r->table = NULL;
+    r->missing = NULL;
+    release_partial(r);  /* Left by a failure */
+  } else
+    r = attach_reader(in);
+  r->resumable = -1;
+
+  return r;
+}
+
+/* Give back the reader once nothing but white space is left */
+
+void finish_reader(READER *r)
+{
+  char *scan = r->pos;
+
+  while(scan < r->end && ISSPACE(*scan))
+    scan++;
+  if(scan == r->end && (r->map || feof(r->file)))
+    detach_reader(r);
+
+  return;
+}
+
+/* Map the rest of a regular file (read-only) for parsing in place; only
+   symbol names are copied (once, to the symbol table); other streams
+   (stdin, pipes) are read through a buffer as before */
+
+int map_input(FILE *in)
+{
+#ifdef MAPPED_INPUT
+  READER *r = current_context->readers;
+  struct stat info;
+  char *map = NULL;
+  long start = 0;
+
+  while(r && r->file != in)
+    r = r->next;
+
+  if(r && !same_stream(r, in)) {
+    release_reader(r);
+    r = NULL;
+  }
+
+  if(r) {
+    if(r->map)
+      return -1;
+    detach_reader(r);
+  }
+
+  if(fstat(fileno(in), &info) != 0 || !S_ISREG(info.st_mode) ||
+     info.st_size == 0 || (start = ftell(in)) < 0)
+    return 0;
+
+  map = (char *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+		     fileno(in), 0);
+  if(map == MAP_FAILED)
+    return 0;
+
+#ifdef HAVE_MADVISE
+  madvise(map, info.st_size, MADV_SEQUENTIAL);
+#endif
+
+  r = new_reader(in);
+  r->map = map;
+  r->map_size = info.st_size;
+  r->device = info.st_dev;
+  r->inode = info.st_ino;
+  r->buf = map;
+  r->pos = &map[start];
+  r->end = &map[info.st_size];
+  r->position = start;
+
+  return -1;
+#else
+  return 0;
+#endif
+}
+
+void unmap_input(FILE *in)
+{
+  READER *r = current_context->readers;
+
+  while(r && r->file != in)
+    r = r->next;
+
+  if(r && r->map) {
+    if(!r->detached)
+      fseek(in, (long)(r->pos - r->map), SEEK_SET);
+    release_reader(r);
+  }
+
+  return;
+}
+
+long count_lines(char *from, char *to)
+{
+  long lines = 0;
+
+  while((from = memchr(from, '\n', to - from)) != NULL) {
+    lines++;
+    from++;
+  }
+
+  return lines;
+}
+
+/* Read more data; the keep characters preceding pos are preserved */
+
+int fill_buffer(READER *r, int keep)
+{
+  char *start = r->pos - keep;
+  int left = r->end - start;
+  size_t cnt = 0;
+
+  if(r->map)
+    return 0;  /* The whole file is available */
+
+  if(start != r->buf) {
+    if(!r->seekable)  /* Lines cannot be counted from the stream later */
+      r->lines += count_lines(r->buf, start);
+    r->base += start - r->buf;
+    memmove(r->buf, start, left);
+  }
+
+  if(left == r->size) {
+    r->size *= 2;
+    r->buf = (char *)realloc(r->buf, r->size);
+  }
+
+  r->pos = &(r->buf)[keep];
+  r->end = &(r->buf)[left];
+
+  cnt = fread(r->end, 1, r->size - left, r->file);
+  r->end += cnt;
+
+  return (int)cnt;
+}
+
+int fill_getc(READER *r)
+{
+  if(fill_buffer(r, 0) == 0)
+    return EOF;
+
+  return (unsigned char)*(r->pos)++;
+}
+
+int skip_space(READER *r)
 {
-  BUFSEQ *bs = (BUFSEQ *)malloc(sizeof(BUFSEQ));
-  BUFSEQ *first = bs;
-  int i = 0;
   int ch = 0;
+
+  do
+    ch = RGETC(r);
+  while(ISSPACE(ch));
+
+  return ch;
+}
+
+/* Read a decimal number (cf. fscanf(in, " %li", ...)) */
+
+int scan_long(READER *r, long *value)
+{
+  int ch = skip_space(r);
+  int negative = 0;
+  unsigned long number = 0;
+
+  if(ch == '-' || ch == '+') {
+    negative = (ch == '-');
+    ch = RGETC(r);
+  }
+
+  if(!ISDIGIT(ch)) {
+    RUNGETC(ch, r);
+    return 0;
+  }
+
+  do {
+    number = 10*number + (ch - '0');
+    ch = RGETC(r);
+  } while(ISDIGIT(ch));
+
+  RUNGETC(ch, r);
+
+  *value = negative ? -(long)number : (long)number;
+
+  return 1;
+}
+
+int scan_int(READER *r, int *value)
+{
+  long number = 0;
+
+  if(!scan_long(r, &number))
+    return 0;
+
+  *value = (int)number;
+
+  return 1;
+}
+
+/* Read a string delimited by white space; NULL at the end of file */
+
+char *scan_string(READER *r)
+{
+  int ch = skip_space(r);
   int len = 0;
   char *result = NULL;
 
-  bs->buf = (char *)malloc(BUFSIZE);
-  bs->next = NULL;
-
-  ch = fgetc(in);
-  while(isspace(ch))
-    ch = fgetc(in);
-  if(ch != EOF)
-    ungetc(ch, in);
-
-  while((ch = fgetc(in)) != EOF && !isspace(ch)) {
-    if(i==BUFSIZE) {
-      bs->next = (BUFSEQ *)malloc(sizeof(BUFSEQ));
-      bs = bs->next;
-      bs->buf = (char *)malloc(BUFSIZE);
-      bs->next = NULL;
-      i = 0;
+  RUNGETC(ch, r);
+
+  for(;;) {
+    while(&(r->pos)[len] < r->end && !ISSPACE((r->pos)[len]))
+      len++;
+    if(&(r->pos)[len] < r->end)
+      break;
+    r->pos += len;
+    if(fill_buffer(r, len) == 0) {
+      r->pos = r->end;
+      return NULL;
     }
-    (bs->buf)[i++] = (char) ch;
-    len++;
+    r->pos -= len;
   }
-  if(isspace(ch))
-    ungetc(ch, in);
 
-  if(ch == EOF) {
-    result = NULL;
+  result = (char *)malloc(len+1);
+  memcpy(result, r->pos, len);
+  result[len] = '\0';
+  r->pos += len;
 
-    while(first != bs) {
-      BUFSEQ *prev = first;
+  return result;
+}
 
-      first = first->next;
-      free(prev->buf);
-      free(prev);
-    }
-    free(first->buf);
-    free(first);
+/* Read a name (consuming the delimiter); a name is terminated in place
+   in a buffer but copied to a scratch area from a mapping, which is
+   read-only; in either case it must be copied before reading further */
 
-  } else {
-    char *scan = (char *)malloc(len+1);
+char *scan_name(READER *r)
+{
+  char *name = NULL;
+  int ch = skip_space(r);
+  int len = 0;
 
-    result = scan;
-    while(first != bs) {
-      BUFSEQ *prev = first;
+  RUNGETC(ch, r);
 
-      memcpy(scan, first->buf, BUFSIZE);
-      scan = &scan[BUFSIZE];
-      first = first->next;
+  for(;;) {
+    while(&(r->pos)[len] < r->end && !ISSPACE((r->pos)[len]))
+      len++;
+    if(&(r->pos)[len] < r->end)
+      break;
+    r->pos += len;
+    if(fill_buffer(r, len) == 0) {
+      r->pos = r->end;
+      return NULL;
+    }
+    r->pos -= len;
+  }
 
-      free(prev->buf);
-      free(prev);
+  if(r->map) {
+    if(len >= r->copy_size) {
+      r->copy_size = 2*len+1;
+      r->copy = (char *)realloc(r->copy, r->copy_size);
     }
-    memcpy(scan, first->buf, i);
-    scan[i] = '\0';
-    free(first->buf);
-    free(first);
+    name = memcpy(r->copy, r->pos, len);
+  } else {
+    name = r->pos;
+    if(name[len] == '\n')
+      r->names++;
   }
+  name[len] = '\0';
+  r->pos += len+1;
+
+  return name;
+}
+
+char *read_string(FILE *in)
+{
+  READER *r = attach_reader(in);
+  char *result = scan_string(r);
+
+  detach_reader(r);
 
   return result;
 }
 
-int read_atom(FILE *in, char *msg)
+/* Position of the next unread character: the byte offset in the stream
+   and the line number (counted from the start of a seekable stream) */
+
+void input_position(READER *r, long *offset, int *line)
+{
+  long lines = 0;
+
+  *offset = r->base + (r->pos - r->buf);
+
+  if(r->seekable) {  /* The buffer may have been modified */
+    long where = ftell(r->file);
+    char block[4096];
+    long left = *offset;
+    size_t cnt = 0;
+
+    if(where >= 0 && fseek(r->file, 0, SEEK_SET) == 0) {
+      while(left > 0 &&
+	    (cnt = fread(block, 1, left < 4096 ? left : 4096, r->file)) > 0) {
+	lines += count_lines(block, &block[cnt]);
+	left -= cnt;
+      }
+      fseek(r->file, where, SEEK_SET);
+    }
+  } else
+    lines = r->lines + count_lines(r->buf, r->pos) + r->names;
+
+  *line = (int)lines + 1;
+
+  return;
+}
+
+/* Errors abort parsing of a chunk (see below) rather than the run */
+
+void input_failure(READER *r, int code, char *msg)
+{
+  long offset = 0;
+  int line = 0;
+
+  if(r->abort)
+    longjmp(*(r->abort), -1);
+
+  input_position(r, &offset, &line);
+  failure_at(code, offset, line, "%s", msg);
+}
+
+void input_error(READER *r, char *msg)
+{
+  input_failure(r, ERROR_SYNTAX, msg);
+}
+
+int read_atom(READER *r, char *msg)
 {
   int atom = 0;
 
-  if(fscanf(in, " %i", &atom) != 1) error(msg);
+  if(!scan_int(r, &atom)) input_error(r, msg);
 
-  if(atom>max_atom)
-    max_atom = atom;
+  if(atom>*(r->max))
+    *(r->max) = atom;
 
   return atom;
 }
 
-void read_atom_list(FILE *in, int cnt, int *table, char *msg)
+void read_atom_list(READER *r, int cnt, int *table, char *msg)
 {
   int i = 0;
   int atom = 0;
 
   for(i=0; i<cnt; i++) {
-    if(fscanf(in, " %i", &atom) != 1) error(msg);
+    if(!scan_int(r, &atom)) input_error(r, msg);
 
     table[i] = atom;
-    if(atom>max_atom)
-      max_atom = atom;
+    if(atom>*(r->max))
+      *(r->max) = atom;
   }
 
   return;
 }
 
-void read_weight_list(FILE *in, int cnt, int *table, char *msg)
+void read_weight_list(READER *r, int cnt, int *table, char *msg)
 {
   int i = 0;
   int weight = 0;
 
   for(i=0; i<cnt; i++) {
-    if(fscanf(in, " %i", &weight) != 1) error(msg);
+    if(!scan_int(r, &weight)) input_error(r, msg);
 
     table[i] = weight;
   }
@@ -183,9 +729,251 @@ void read_weight_list(FILE *in, int cnt, int *table, char *msg)
   return;
 }
 
+/* ------------------------ Parsing in parallel ---------------------------- */
+
+/* Large memory-mapped inputs are split into chunks at line boundaries
+   and each chunk is parsed on its own by a reader of its own. Errors
+   within a chunk merely mark the chunk as failed; the caller then parses
+   the input sequentially so that errors are reported as usual. */
+
+#define CHUNK_MIN (1<<18)  /* Smallest chunk worth a job */
+
+typedef struct chunk {
+  char *start;          /* Text of the chunk */
+  char *end;
+  char *last;           /* End of the last item read */
+  int cnt;              /* Number of items read */
+  int max;              /* Largest atom number encountered */
+  int failed;
+  RULE *first;          /* Rules (or clauses) read */
+  RULE *tail;
+  RTAB *rules;          /* Rules read into a table (instead of a list) */
+  RULE_ARENA *arena;    /* Where the rules are allocated (if anywhere) */
+  int *atoms;           /* Named atoms outside the table (symbols) */
+  SYMBOL **symbols;     /* Their names */
+  int missing;          /* Number of such atoms */
+  int missing_size;
+} CHUNK;
+
+typedef struct chunks {
+  CHUNK *chunk;
+  int jobs;
+  int weighted;         /* Clauses have weights */
+  ATAB *table;          /* Table being named */
+} CHUNKS;
+
+int split_chunks(CHUNKS *chunks, READER *r, char *end)
+{
+  char *start = r->pos;
+  size_t size = end - start;
+  char *from = start;
+  int jobs = 4*worker_threads;
+  int i = 0;
+
+  if(worker_threads < 2)
+    return 0;
+  if(size/jobs < CHUNK_MIN)
+    jobs = size/CHUNK_MIN;
+  if(jobs < 2)
+    return 0;
+
+  chunks->chunk = (CHUNK *)malloc(jobs*sizeof(CHUNK));
+  chunks->jobs = jobs;
+  chunks->weighted = 0;
+  chunks->table = NULL;
+
+  /* Split at the line boundaries following even positions */
+
+  for(i=0; i<jobs; i++) {
+    CHUNK *chunk = &(chunks->chunk)[i];
+    char *to = end;
+
+    if(i < jobs-1) {
+      to = &start[(size/jobs)*(i+1)];
+      if(to < from)
+	to = from;
+      to = memchr(to, '\n', end - to);
+      to = to ? to+1 : end;
+    }
+
+    chunk->start = from;
+    chunk->end = to;
+    chunk->last = from;
+    chunk->cnt = 0;
+    chunk->max = 0;
+    chunk->failed = 0;
+    chunk->first = NULL;
+    chunk->tail = NULL;
+    chunk->rules = NULL;
+    chunk->arena = r->arena ? new_rule_arena() : NULL;
+    chunk->atoms = NULL;
+    chunk->symbols = NULL;
+    chunk->missing = 0;
+    chunk->missing_size = 0;
+    from = to;
+  }
+
+  return jobs;
+}
+
+/* A reader over a chunk only (not linked to other readers) */
+
+void open_chunk(READER *r, CHUNK *chunk, jmp_buf *abort)
+{
+  r->file = NULL;
+  r->buf = chunk->start;
+  r->pos = chunk->start;
+  r->end = chunk->end;
+  r->base = 0;
+  r->lines = 0;
+  r->names = 0;
+  r->size = 0;
+  r->seekable = 0;
+  r->map = chunk->start;
+  r->map_size = chunk->end - chunk->start;
+  r->position = 0;
+  r->detached = 0;
+  r->resumable = 0;
+  r->lits = NULL;
+  r->lits_size = 0;
+  r->copy = NULL;
+  r->copy_size = 0;
+  r->max = &(chunk->max);
+  r->arena = chunk->arena;
+  r->abort = abort;
+  r->table = NULL;
+  r->missing = NULL;
+  r->rules = NULL;
+  r->list = NULL;
+  r->partial_cnt = 0;
+  r->next = NULL;
+
+  return;
+}
+
+void free_chunk(CHUNK *chunk)
+{
+  RULE *scan = chunk->first;
+
+  if(chunk->arena) {  /* Including partially read rules */
+    free_rule_arena(chunk->arena);
+    chunk->arena = NULL;
+    scan = NULL;
+  }
+
+  while(scan) {
+    RULE *next = scan->next;
+
+    free_rule(scan);
+    scan = next;
+  }
+  chunk->first = NULL;
+  chunk->tail = NULL;
+
+  if(chunk->rules) {
+    free_rtab(chunk->rules);
+    chunk->rules = NULL;
+  }
+
+  return;
+}
+
+void close_chunk(READER *r, CHUNK *chunk)
+{
+  if(chunk->failed) {
+    free_chunk(chunk);
+    release_partial(r);
+  }
+
+  if(r->lits)
+    free(r->lits);
+  if(r->copy)
+    free(r->copy);
+
+  return;
+}
+
+/* Count an item read (and append it to the list unless it went to the
+   table of the chunk) */
+
+void add_to_chunk(CHUNK *chunk, RULE *new, char *last)
+{
+  if(new) {
+    if(chunk->tail)
+      chunk->tail->next = new;
+    else
+      chunk->first = new;
+    chunk->tail = new;
+  }
+  chunk->last = last;
+  chunk->cnt++;
+
+  return;
+}
+
+/* Release the chunks (and return zero) if some chunk failed or the
+   number of items differs from the expected one (if non-negative) */
+
+int complete_chunks(CHUNKS *chunks, int expected)
+{
+  int total = 0;
+  int failed = 0;
+  int i = 0;
+
+  for(i=0; i<chunks->jobs; i++) {
+    if((chunks->chunk)[i].failed)
+      failed = -1;
+    total += (chunks->chunk)[i].cnt;
+  }
+
+  if(failed || (expected >= 0 && total != expected) || total == 0) {
+    for(i=0; i<chunks->jobs; i++)
+      free_chunk(&(chunks->chunk)[i]);
+    free(chunks->chunk);
+    return 0;
+  }
+
+  return -1;
+}
+
+/* Splice the lists of the chunks together in the order of appearance
+   and continue reading after the last item; NULL is returned if the
+   chunks are not complete (see above) */
+
+RULE *join_chunks(CHUNKS *chunks, READER *r, int expected)
+{
+  RULE *list = NULL;
+  RULE *last = NULL;
+  int i = 0;
+
+  if(!complete_chunks(chunks, expected))
+    return NULL;
+
+  for(i=0; i<chunks->jobs; i++) {
+    CHUNK *chunk = &(chunks->chunk)[i];
+
+    if(chunk->first) {
+      if(last)
+	last->next = chunk->first;
+      else
+	list = chunk->first;
+      last = chunk->tail;
+      r->pos = chunk->last;
+    }
+    if(chunk->max > *(r->max))
+      *(r->max) = chunk->max;
+    if(chunk->arena)
+      merge_rule_arenas(r->arena, chunk->arena);
+  }
+
+  free(chunks->chunk);
+
+  return list;
+}
+
 /* --------------------- Read in a smodels program ------------------------- */
 
-RULE *read_basic(FILE *in)
+RULE *read_basic(READER *r)
 {
   int head = 0;
   int atom = 0;
@@ -195,41 +983,42 @@ RULE *read_basic(FILE *in)
   int *table = NULL;
   int i = 0;
 
-  RULE *new = (RULE *)malloc(sizeof(RULE));
-  BASIC_RULE *basic = (BASIC_RULE *)malloc(sizeof(BASIC_RULE));
+  RULE *new = (RULE *)RALLOC(r, sizeof(RULE));
+  BASIC_RULE *basic = (BASIC_RULE *)RALLOC(r, sizeof(BASIC_RULE));
 
   new->type = TYPE_BASIC;
+  new->arena = r->arena ? RULE_IN_ARENA : 0;
   new->data.basic = basic;
   new->next = NULL;
 
-  basic->head = read_atom(in, "basic rule, missing head");
+  basic->head = read_atom(r, "basic rule, missing head");
 
-  if(fscanf(in, " %i", &lit_cnt) != 1)
-    error("basic rule, missing literal count");
-  if(fscanf(in, " %i", &neg_cnt) != 1)
-    error("basic rule, missing negative count");
+  if(!scan_int(r, &lit_cnt))
+    input_error(r, "basic rule, missing literal count");
+  if(!scan_int(r, &neg_cnt))
+    input_error(r, "basic rule, missing negative count");
 
   pos_cnt = lit_cnt - neg_cnt;
   if(pos_cnt < 0)
-    error("basic rule, invalid positive count");
+    input_error(r, "basic rule, invalid positive count");
 
-  table = (int *)malloc(lit_cnt * sizeof(int));
+  table = (int *)RALLOC(r, lit_cnt * sizeof(int));
 
   basic->neg_cnt = neg_cnt;
   basic->pos_cnt = pos_cnt;
   basic->neg = table;
   basic->pos = &table[neg_cnt];
 
-  read_atom_list(in, neg_cnt, basic->neg,
+  read_atom_list(r, neg_cnt, basic->neg,
 		 "basic rule, missing negative literal");
 
-  read_atom_list(in, pos_cnt, basic->pos,
+  read_atom_list(r, pos_cnt, basic->pos,
 		 "basic rule, missing positive literal");
 
   return new;
 }
 
-RULE *read_constraint(FILE *in)
+RULE *read_constraint(READER *r)
 {
   int head = 0;
   int bound = 0;
@@ -240,46 +1029,47 @@ RULE *read_constraint(FILE *in)
   int *table = NULL;
   int i = 0;
 
-  RULE *new = (RULE *)malloc(sizeof(RULE));
+  RULE *new = (RULE *)RALLOC(r, sizeof(RULE));
   CONSTRAINT_RULE *constraint =
-    (CONSTRAINT_RULE *)malloc(sizeof(CONSTRAINT_RULE));
+    (CONSTRAINT_RULE *)RALLOC(r, sizeof(CONSTRAINT_RULE));
 
   new->type = TYPE_CONSTRAINT;
+  new->arena = r->arena ? RULE_IN_ARENA : 0;
   new->data.constraint = constraint;
   new->next = NULL;
 
-  constraint->head = read_atom(in, "constraint rule, missing head");
+  constraint->head = read_atom(r, "constraint rule, missing head");
 
-  if(fscanf(in, " %i", &lit_cnt) != 1)
-    error("constraint rule, missing literal count");
-  if(fscanf(in, " %i", &neg_cnt) != 1)
-    error("constraint rule, missing negative count");
-  if(fscanf(in, " %i", &bound) != 1)
-    error("constraint rule, missing bound");
+  if(!scan_int(r, &lit_cnt))
+    input_error(r, "constraint rule, missing literal count");
+  if(!scan_int(r, &neg_cnt))
+    input_error(r, "constraint rule, missing negative count");
+  if(!scan_int(r, &bound))
+    input_error(r, "constraint rule, missing bound");
 
   constraint->bound = bound;
 
   pos_cnt = lit_cnt - neg_cnt;
   if(pos_cnt < 0)
-    error("constraint rule, invalid positive count");
+    input_error(r, "constraint rule, invalid positive count");
 
-  table = (int *)malloc(lit_cnt * sizeof(int));
+  table = (int *)RALLOC(r, lit_cnt * sizeof(int));
 
   constraint->neg_cnt = neg_cnt;
   constraint->neg = table;
   constraint->pos_cnt = pos_cnt;
   constraint->pos = &table[neg_cnt];
 
-  read_atom_list(in, neg_cnt, constraint->neg,
+  read_atom_list(r, neg_cnt, constraint->neg,
 		 "constraint rule, missing negative literal");
 
-  read_atom_list(in, pos_cnt, constraint->pos,
+  read_atom_list(r, pos_cnt, constraint->pos,
 		 "constraint rule, missing positive literal");
 
   return new;
 }
 
-RULE *read_choice(FILE *in)
+RULE *read_choice(READER *r)
 {
   int head_cnt = 0;
   int atom = 0;
@@ -289,50 +1079,51 @@ RULE *read_choice(FILE *in)
   int *table = NULL;
   int i = 0;
 
-  RULE *new = (RULE *)malloc(sizeof(RULE));
-  CHOICE_RULE *choice = (CHOICE_RULE *)malloc(sizeof(CHOICE_RULE));
+  RULE *new = (RULE *)RALLOC(r, sizeof(RULE));
+  CHOICE_RULE *choice = (CHOICE_RULE *)RALLOC(r, sizeof(CHOICE_RULE));
 
   new->type = TYPE_CHOICE;
+  new->arena = r->arena ? RULE_IN_ARENA : 0;
   new->data.choice = choice;
   new->next = NULL;
 
-  if(fscanf(in, " %i", &head_cnt) != 1)
-    error("choice rule, missing head count");
+  if(!scan_int(r, &head_cnt))
+    input_error(r, "choice rule, missing head count");
 
-  table = (int *)malloc(head_cnt * sizeof(int));
+  table = (int *)RALLOC(r, head_cnt * sizeof(int));
 
   choice->head_cnt = head_cnt;
   choice->head = table;
 
-  read_atom_list(in, head_cnt, choice->head,
+  read_atom_list(r, head_cnt, choice->head,
 		 "choice rule, missing head atom");
 
-  if(fscanf(in, " %i", &lit_cnt) != 1)
-    error("choice rule, missing literal count");
-  if(fscanf(in, " %i", &neg_cnt) != 1)
-    error("choice rule, missing negative count");
+  if(!scan_int(r, &lit_cnt))
+    input_error(r, "choice rule, missing literal count");
+  if(!scan_int(r, &neg_cnt))
+    input_error(r, "choice rule, missing negative count");
 
   pos_cnt = lit_cnt - neg_cnt;
   if(pos_cnt < 0)
-    error("choice rule, invalid positive count");
+    input_error(r, "choice rule, invalid positive count");
 
-  table = (int *)malloc(lit_cnt * sizeof(int));
+  table = (int *)RALLOC(r, lit_cnt * sizeof(int));
 
   choice->neg_cnt = neg_cnt;
   choice->neg = table;
   choice->pos_cnt = pos_cnt;
   choice->pos = &table[neg_cnt];
 
-  read_atom_list(in, neg_cnt, choice->neg,
+  read_atom_list(r, neg_cnt, choice->neg,
 		 "choice rule, missing negative literal");
 
-  read_atom_list(in, pos_cnt, choice->pos,
+  read_atom_list(r, pos_cnt, choice->pos,
 		 "choice rule, missing positive literal");
 
   return new;
 }
 
-RULE *read_integrity(FILE *in)
+RULE *read_integrity(READER *r)
 {
   int atom = 0;
   int lit_cnt = 0;
@@ -341,39 +1132,41 @@ RULE *read_integrity(FILE *in)
   int *table = NULL;
   int i = 0;
 
-  RULE *new = (RULE *)malloc(sizeof(RULE));
-  INTEGRITY_RULE *integrity = (INTEGRITY_RULE *)malloc(sizeof(INTEGRITY_RULE));
+  RULE *new = (RULE *)RALLOC(r, sizeof(RULE));
+  INTEGRITY_RULE *integrity =
+    (INTEGRITY_RULE *)RALLOC(r, sizeof(INTEGRITY_RULE));
 
   new->type = TYPE_INTEGRITY;
+  new->arena = r->arena ? RULE_IN_ARENA : 0;
   new->data.integrity = integrity;
   new->next = NULL;
 
-  if(fscanf(in, " %i", &lit_cnt) != 1)
-    error("integrity rule, missing literal count");
-  if(fscanf(in, " %i", &neg_cnt) != 1)
-    error("integrity rule, missing negative count");
+  if(!scan_int(r, &lit_cnt))
+    input_error(r, "integrity rule, missing literal count");
+  if(!scan_int(r, &neg_cnt))
+    input_error(r, "integrity rule, missing negative count");
 
   pos_cnt = lit_cnt - neg_cnt;
   if(pos_cnt < 0)
-    error("integrity rule, invalid positive count");
+    input_error(r, "integrity rule, invalid positive count");
 
-  table = (int *)malloc(lit_cnt * sizeof(int));
+  table = (int *)RALLOC(r, lit_cnt * sizeof(int));
 
   integrity->neg_cnt = neg_cnt;
   integrity->neg = table;
   integrity->pos_cnt = pos_cnt;
   integrity->pos = &table[neg_cnt];
 
-  read_atom_list(in, neg_cnt, integrity->neg,
+  read_atom_list(r, neg_cnt, integrity->neg,
 		 "integrity rule, missing negative literal");
 
-  read_atom_list(in, pos_cnt, integrity->pos,
+  read_atom_list(r, pos_cnt, integrity->pos,
 		 "integrity rule, missing positive literal");
 
   return new;
 }
 
-RULE *read_weight(FILE *in)
+RULE *read_weight(READER *r)
 {
   int head = 0;
   int bound = 0;
@@ -384,31 +1177,32 @@ RULE *read_weight(FILE *in)
   int *table = NULL;
   int i = 0;
 
-  RULE *new = (RULE *)malloc(sizeof(RULE));
+  RULE *new = (RULE *)RALLOC(r, sizeof(RULE));
   WEIGHT_RULE *weight =
-    (WEIGHT_RULE *)malloc(sizeof(WEIGHT_RULE));
+    (WEIGHT_RULE *)RALLOC(r, sizeof(WEIGHT_RULE));
 
   new->type = TYPE_WEIGHT;
+  new->arena = r->arena ? RULE_IN_ARENA : 0;
   new->data.weight = weight;
   new->next = NULL;
 
-  weight->head = read_atom(in, "weight rule, missing head");
+  weight->head = read_atom(r, "weight rule, missing head");
 
-  if(fscanf(in, " %i", &bound) != 1)
-    error("weight rule, missing bound");
+  if(!scan_int(r, &bound))
+    input_error(r, "weight rule, missing bound");
 
   weight->bound = bound;
 
-  if(fscanf(in, " %i", &lit_cnt) != 1)
-    error("weight rule, missing literal count");
-  if(fscanf(in, " %i", &neg_cnt) != 1)
-    error("weight rule, missing negative count");
+  if(!scan_int(r, &lit_cnt))
+    input_error(r, "weight rule, missing literal count");
+  if(!scan_int(r, &neg_cnt))
+    input_error(r, "weight rule, missing negative count");
 
   pos_cnt = lit_cnt - neg_cnt;
   if(pos_cnt < 0)
-    error("weight rule, invalid positive count");
+    input_error(r, "weight rule, invalid positive count");
 
-  table = (int *)malloc(2 * lit_cnt * sizeof(int));
+  table = (int *)RALLOC(r, 2 * lit_cnt * sizeof(int));
 
   weight->neg_cnt = neg_cnt;
   weight->neg = table;
@@ -416,19 +1210,19 @@ RULE *read_weight(FILE *in)
   weight->pos = &table[neg_cnt];
   weight->weight = &table[neg_cnt+pos_cnt];
 
-  read_atom_list(in, neg_cnt, weight->neg,
+  read_atom_list(r, neg_cnt, weight->neg,
 		 "weight rule, missing negative literal");
 
-  read_atom_list(in, pos_cnt, weight->pos,
+  read_atom_list(r, pos_cnt, weight->pos,
 		 "weight rule, missing positive literal");
 
-  read_weight_list(in, lit_cnt, weight->weight,
+  read_weight_list(r, lit_cnt, weight->weight,
 		   "weight rule, missing weight");
 
   return new;
 }
 
-RULE *read_optimize(FILE *in)
+RULE *read_optimize(READER *r)
 {
   int bound = -1;
   int atom = 0;
@@ -438,27 +1232,28 @@ RULE *read_optimize(FILE *in)
   int *table = NULL;
   int i = 0;
 
-  RULE *new = (RULE *)malloc(sizeof(RULE));
+  RULE *new = (RULE *)RALLOC(r, sizeof(RULE));
   OPTIMIZE_RULE *optimize =
-    (OPTIMIZE_RULE *)malloc(sizeof(OPTIMIZE_RULE));
+    (OPTIMIZE_RULE *)RALLOC(r, sizeof(OPTIMIZE_RULE));
 
   new->type = TYPE_OPTIMIZE;
+  new->arena = r->arena ? RULE_IN_ARENA : 0;
   new->data.optimize = optimize;
   new->next = NULL;
 
-  if(fscanf(in, " %i", &bound) != 1 || bound != 0)
-    error("optimize statement, missing 0 field");
+  if(!scan_int(r, &bound) || bound != 0)
+    input_error(r, "optimize statement, missing 0 field");
 
-  if(fscanf(in, " %i", &lit_cnt) != 1)
-    error("optimize statement, missing literal count");
-  if(fscanf(in, " %i", &neg_cnt) != 1)
-    error("optimize statement, missing negative count");
+  if(!scan_int(r, &lit_cnt))
+    input_error(r, "optimize statement, missing literal count");
+  if(!scan_int(r, &neg_cnt))
+    input_error(r, "optimize statement, missing negative count");
 
   pos_cnt = lit_cnt - neg_cnt;
   if(pos_cnt < 0)
-    error("optimize statement, invalid positive count");
+    input_error(r, "optimize statement, invalid positive count");
 
-  table = (int *)malloc(2 * lit_cnt * sizeof(int));
+  table = (int *)RALLOC(r, 2 * lit_cnt * sizeof(int));
 
   optimize->neg_cnt = neg_cnt;
   optimize->neg = table;
@@ -466,19 +1261,19 @@ RULE *read_optimize(FILE *in)
   optimize->pos = &table[neg_cnt];
   optimize->weight = &table[neg_cnt+pos_cnt];
 
-  read_atom_list(in, neg_cnt, optimize->neg,
+  read_atom_list(r, neg_cnt, optimize->neg,
 		 "optimize statement, missing negative literal");
 
-  read_atom_list(in, pos_cnt, optimize->pos,
+  read_atom_list(r, pos_cnt, optimize->pos,
 		 "optimize statement, missing positive literal");
 
-  read_weight_list(in, lit_cnt, optimize->weight,
+  read_weight_list(r, lit_cnt, optimize->weight,
 		   "optimize statement, missing weight");
 
   return new;
 }
 
-RULE *read_disjunctive(FILE *in)
+RULE *read_disjunctive(READER *r)
 {
   int head_cnt = 0;
   int atom = 0;
@@ -488,45 +1283,46 @@ RULE *read_disjunctive(FILE *in)
   int *table = NULL;
   int i = 0;
 
-  RULE *new = (RULE *)malloc(sizeof(RULE));
+  RULE *new = (RULE *)RALLOC(r, sizeof(RULE));
   DISJUNCTIVE_RULE *disjunctive =
-    (DISJUNCTIVE_RULE *)malloc(sizeof(DISJUNCTIVE_RULE));
+    (DISJUNCTIVE_RULE *)RALLOC(r, sizeof(DISJUNCTIVE_RULE));
 
   new->type = TYPE_DISJUNCTIVE;
+  new->arena = r->arena ? RULE_IN_ARENA : 0;
   new->data.disjunctive = disjunctive;
   new->next = NULL;
 
-  if(fscanf(in, " %i", &head_cnt) != 1)
-    error("disjunctive rule, missing head count");
+  if(!scan_int(r, &head_cnt))
+    input_error(r, "disjunctive rule, missing head count");
 
-  table = (int *)malloc(head_cnt * sizeof(int));
+  table = (int *)RALLOC(r, head_cnt * sizeof(int));
 
   disjunctive->head_cnt = head_cnt;
   disjunctive->head = table;
 
-  read_atom_list(in, head_cnt, disjunctive->head,
+  read_atom_list(r, head_cnt, disjunctive->head,
 		 "disjunctive rule, missing head atom");
 
-  if(fscanf(in, " %i", &lit_cnt) != 1)
-    error("disjunctive rule, missing literal count");
-  if(fscanf(in, " %i", &neg_cnt) != 1)
-    error("disjunctive rule, missing negative count");
+  if(!scan_int(r, &lit_cnt))
+    input_error(r, "disjunctive rule, missing literal count");
+  if(!scan_int(r, &neg_cnt))
+    input_error(r, "disjunctive rule, missing negative count");
 
   pos_cnt = lit_cnt - neg_cnt;
   if(pos_cnt < 0)
-    error("disjunctive rule, invalid positive count");
+    input_error(r, "disjunctive rule, invalid positive count");
 
-  table = (int *)malloc(lit_cnt * sizeof(int));
+  table = (int *)RALLOC(r, lit_cnt * sizeof(int));
 
   disjunctive->neg_cnt = neg_cnt;
   disjunctive->neg = table;
   disjunctive->pos_cnt = pos_cnt;
   disjunctive->pos = &table[neg_cnt];
 
-  read_atom_list(in, neg_cnt, disjunctive->neg,
+  read_atom_list(r, neg_cnt, disjunctive->neg,
 		 "disjunctive rule, missing negative literal");
 
-  read_atom_list(in, pos_cnt, disjunctive->pos,
+  read_atom_list(r, pos_cnt, disjunctive->pos,
 		 "disjunctive rule, missing positive literal");
 
   return new;
@@ -534,207 +1330,775 @@ RULE *read_disjunctive(FILE *in)
 
 void initialize_program()
 {
-  max_atom = 0;
+  READER *r = NULL;
+
+  current_context->max_atom = 0;
+
+  for(r = current_context->readers; r; r = r->next)
+    r->resumable = 0;
 }
 
-RULE *read_rule(FILE *in)
+/* Read a rule of the given type; NULL is returned for unknown types */
+
+RULE *scan_rule(READER *r, int type)
 {
-  int type = 0;
   RULE *rule = NULL;
 
-  if(fscanf(in, " %i", &type) != 1)
-    error("unknown rule type");
-
   switch(type) {
   case TYPE_BASIC:
-    rule = read_basic(in);
+    rule = read_basic(r);
     if(!rule)
-      error("erroneous basic rule");
+      input_error(r, "erroneous basic rule");
     break;
 
   case TYPE_CONSTRAINT:
-    rule = read_constraint(in);
+    rule = read_constraint(r);
     if(!rule)
-      error("erroneous constraint rule");
+      input_error(r, "erroneous constraint rule");
     break;
 
   case TYPE_CHOICE:
-    rule = read_choice(in);
+    rule = read_choice(r);
     if(!rule)
-      error("erroneous choice rule");
+      input_error(r, "erroneous choice rule");
     break;
 
   case TYPE_INTEGRITY:
-    rule = read_integrity(in);
+    rule = read_integrity(r);
     if(!rule)
-      error("erroneous integrity rule");
+      input_error(r, "erroneous integrity rule");
     break;
 
   case TYPE_WEIGHT:
-    rule = read_weight(in);
+    rule = read_weight(r);
     if(!rule)
-      error("erroneous weight rule");
+      input_error(r, "erroneous weight rule");
     break;
 
   case TYPE_OPTIMIZE:
-    rule = read_optimize(in);
+    rule = read_optimize(r);
     if(!rule)
-      error("erroneous optimize statement");
+      input_error(r, "erroneous optimize statement");
     break;
 
   case TYPE_ORDERED:
-    error("ordered disjunctive rules are not supported");
+    input_failure(r, ERROR_UNSUPPORTED,
+		  "ordered disjunctive rules are not supported");
     break;
 
   case TYPE_DISJUNCTIVE:
-    rule = read_disjunctive(in);
+    rule = read_disjunctive(r);
     if(!rule)
-      error("erroneous disjunctive rule");
-    break;
-
-  case 0:
+      input_error(r, "erroneous disjunctive rule");
     break;
 
   default:
-    error("unknown rule type");
     break;
   }
+  r->partial_cnt = 0;  /* Complete */
 
   return rule;
 }
 
-RULE *read_program(FILE *in)
+/* Rules are read into a table of rules (RTAB) in place: the literals go
+   straight to the pool (cf. add_rtab) and no RULE is built */
+
+void rtab_error(READER *r, char *what, char *msg)
 {
-  int type = 0;
-  RULE *program = NULL;
-  RULE *new = NULL;
-  RULE *last = NULL;
+  char text[ERROR_SIZE];
+
+  snprintf(text, ERROR_SIZE, "%s, %s", what, msg);
+  input_error(r, text);
+}
+
+void scan_rtab_list(READER *r, int cnt, int *table, int atoms,
+		    char *what, char *msg)
+{
+  int i = 0;
+
+  for(i=0; i<cnt; i++) {
+    if(!scan_int(r, &table[i]))
+      rtab_error(r, what, msg);
+    if(atoms && table[i] > *(r->max))
+      *(r->max) = table[i];
+  }
+
+  return;
+}
+
+/* Read a rule of the given type into a table; zero is returned for
+   unknown types (cf. scan_rule) */
+
+int scan_rule_rtab(READER *r, int type, RTAB *rules)
+{
+  char *what = NULL;
+  int *lits = NULL;
+  int head_cnt = 1;
+  int lit_cnt = 0;
+  int neg_cnt = 0;
+  int weight_cnt = 0;
+  int bound = 0;
+
+  switch(type) {
+  case TYPE_BASIC:       what = "basic rule"; break;
+  case TYPE_CONSTRAINT:  what = "constraint rule"; break;
+  case TYPE_CHOICE:      what = "choice rule"; break;
+  case TYPE_INTEGRITY:   what = "integrity rule"; head_cnt = 0; break;
+  case TYPE_WEIGHT:      what = "weight rule"; break;
+  case TYPE_OPTIMIZE:    what = "optimize statement"; head_cnt = 0; break;
+  case TYPE_DISJUNCTIVE: what = "disjunctive rule"; break;
+
+  case TYPE_ORDERED:
+    input_failure(r, ERROR_UNSUPPORTED,
+		  "ordered disjunctive rules are not supported");
+    return 0;
+
+  default:
+    return 0;
+  }
+
+  if(type == TYPE_CHOICE || type == TYPE_DISJUNCTIVE) {
+    if(!scan_int(r, &head_cnt))
+      rtab_error(r, what, "missing head count");
+    if(head_cnt < 0)
+      rtab_error(r, what, "invalid head count");
+    grow_rtab(rules, head_cnt);
+    scan_rtab_list(r, head_cnt, &(rules->pool)[rules->used], -1,
+		   what, "missing head atom");
+  } else if(head_cnt) {
+    grow_rtab(rules, 1);
+    scan_rtab_list(r, 1, &(rules->pool)[rules->used], -1,
+		   what, "missing head");
+  }
+
+  if(type == TYPE_WEIGHT && !scan_int(r, &bound))
+    rtab_error(r, what, "missing bound");
+  if(type == TYPE_OPTIMIZE && (!scan_int(r, &bound) || bound != 0))
+    rtab_error(r, what, "missing 0 field");
+
+  if(!scan_int(r, &lit_cnt))
+    rtab_error(r, what, "missing literal count");
+  if(!scan_int(r, &neg_cnt))
+    rtab_error(r, what, "missing negative count");
+
+  if(type == TYPE_CONSTRAINT && !scan_int(r, &bound))
+    rtab_error(r, what, "missing bound");
+
+  if(neg_cnt < 0)
+    rtab_error(r, what, "invalid negative count");
+  if(lit_cnt < neg_cnt)
+    rtab_error(r, what, "invalid positive count");
+
+  if(type == TYPE_WEIGHT || type == TYPE_OPTIMIZE)
+    weight_cnt = lit_cnt;
+
+  grow_rtab(rules, (long)head_cnt + lit_cnt + weight_cnt);
+  lits = &(rules->pool)[rules->used + head_cnt];
+
+  scan_rtab_list(r, neg_cnt, lits, -1, what, "missing negative literal");
+  scan_rtab_list(r, lit_cnt-neg_cnt, &lits[neg_cnt], -1,
+		 what, "missing positive literal");
+  scan_rtab_list(r, weight_cnt, &lits[lit_cnt], 0, what, "missing weight");
+
+  (void) put_rtab(rules, type, head_cnt, neg_cnt, lit_cnt-neg_cnt, bound);
+
+  return -1;
+}
+
+/* The next rule of a sequence (NULL at the end of the rules) */
+
+RULE *scan_next_rule(READER *r)
+{
+  int type = 0;
+  RULE *rule = NULL;
+
+  if(!scan_int(r, &type))
+    input_error(r, "unknown rule type");
+
+  if(type != 0)
+    if((rule = scan_rule(r, type)) == NULL)
+      input_error(r, "unknown rule type");
+
+  if(!rule)
+    detach_reader(r);
+
+  return rule;
+}
+
+RULE *read_rule(FILE *in)
+{
+  return scan_next_rule(resume_reader(in));
+}
+
+/* Read a rule into a buffer (an arena) reused for every rule: the rule
+   remains valid until the next call and must not be freed (the buffer
+   is given to the reader only, which takes the arena of the context
+   again on the next call, even after a failure) */
+
+RULE *read_rule_reusing(FILE *in, RULE_ARENA *buffer)
+{
+  READER *r = resume_reader(in);
+
+  reset_rule_arena(buffer);
+  r->arena = buffer;
+
+  return scan_next_rule(r);
+}
+
+/* Rules of large memory-mapped files are parsed in parallel provided
+   that each rule occupies a line of its own (as lparse and gringo write
+   them); otherwise the sequential parser takes over */
+
+void scan_rule_chunk(void *data, int index)
+{
+  CHUNKS *chunks = (CHUNKS *)data;
+  CHUNK *chunk = &(chunks->chunk)[index];
+  READER r;
+  jmp_buf abort;
+  int ch = 0;
+
+  open_chunk(&r, chunk, &abort);
+
+  if(setjmp(abort) == 0) {
+    while((ch = skip_space(&r)) != EOF) {
+      char *start = r.pos-1;
+      int type = 0;
+      RULE *new = NULL;
+
+      RUNGETC(ch, &r);
+      if(!scan_int(&r, &type))
+	longjmp(abort, -1);
+
+      if(chunk->rules ? !scan_rule_rtab(&r, type, chunk->rules)
+	 : (new = scan_rule(&r, type)) == NULL)
+	longjmp(abort, -1);
+      add_to_chunk(chunk, new, r.pos);
+
+      /* The rule must begin and end on the same line */
+
+      if(memchr(start, '\n', r.pos - start))
+	longjmp(abort, -1);
+
+      while((ch = RGETC(&r)) != '\n' && ch != EOF)
+	if(!ISSPACE(ch))
+	  longjmp(abort, -1);
+    }
+  } else
+    chunk->failed = -1;
+
+  close_chunk(&r, chunk);
+
+  return;
+}
+
+/* Locate the line "0" that ends the rules (or the symbols) */
+
+char *find_end_of_section(char *pos, char *end)
+{
+  char *line = pos;
+
+  while(line && line < end) {
+    if(line[0] == '0' &&
+       (line+1 == end || line[1] == '\n' || line[1] == '\r'))
+      return line;
+    line = memchr(line, '\n', end - line);
+    if(line)
+      line++;
+  }
+
+  return NULL;
+}
+
+RULE *scan_program_parallel(READER *r)
+{
+  CHUNKS chunks;
+  RULE *program = NULL;
+  char *end = NULL;
+
+  if(r->end - r->pos < 2*CHUNK_MIN)
+    return NULL;
+  if((end = find_end_of_section(r->pos, r->end)) == NULL)
+    return NULL;
+  if(!split_chunks(&chunks, r, end))
+    return NULL;
+
+  run_parallel(chunks.jobs, scan_rule_chunk, &chunks);
+
+  if((program = join_chunks(&chunks, r, -1)) != NULL)
+    r->pos = end+1;  /* Skip the final 0 */
+
+  return program;
+}
+
+/* As above but each chunk is read into a table of its own; the tables
+   are appended to the first one in turn (and released on the way) */
+
+RTAB *scan_program_rtab_parallel(READER *r)
+{
+  CHUNKS chunks;
+  RTAB *rules = NULL;
+  char *end = NULL;
+  int i = 0;
+
+  if(r->end - r->pos < 2*CHUNK_MIN)
+    return NULL;
+  if((end = find_end_of_section(r->pos, r->end)) == NULL)
+    return NULL;
+  if(!split_chunks(&chunks, r, end))
+    return NULL;
+
+  for(i=0; i<chunks.jobs; i++)
+    (chunks.chunk)[i].rules = new_rtab(1024, 8192);
+
+  run_parallel(chunks.jobs, scan_rule_chunk, &chunks);
+
+  if(!complete_chunks(&chunks, -1))
+    return NULL;
+
+  for(i=0; i<chunks.jobs; i++) {
+    CHUNK *chunk = &(chunks.chunk)[i];
+
+    if(rules)
+      append_rtab(rules, chunk->rules);
+    else
+      rules = chunk->rules;
+    chunk->rules = NULL;
+    if(chunk->max > *(r->max))
+      *(r->max) = chunk->max;
+  }
+  free(chunks.chunk);
+
+  r->pos = end+1;  /* Skip the final 0 */
+
+  return rules;
+}
+
+RULE *read_program(FILE *in)
+{
+  READER *r = attach_reader(in);
+  int type = 0;
+  RULE *program = NULL;
+  RULE *new = NULL;
+  RULE *last = NULL;
 
   initialize_program();
 
-  if(fscanf(in, " %i", &type) != 1)
-    error("unknown rule type");
+  if(r->map && worker_threads > 1)
+    if((program = scan_program_parallel(r)) != NULL) {
+      detach_reader(r);
+      return program;
+    }
+
+  if(!scan_int(r, &type))
+    input_error(r, "unknown rule type");
 
   while(type != 0) {
-    switch(type) {
-    case TYPE_BASIC:
-      new = read_basic(in);
-      if(!new)
-	error("erroneous basic rule");
+    if((new = scan_rule(r, type)) != NULL) {  /* Unknown types skipped */
       if(last)
 	last->next = new;
-      else
+      else {
 	program = new;
-      last=new;
-      break;
+	if(!r->arena)
+	  r->list = program;  /* Released on failures */
+      }
+      last = new;
+    }
 
-    case TYPE_CONSTRAINT:
-      new = read_constraint(in);
-      if(!new)
-	error("erroneous constraint rule");
-      if(last)
-	last->next = new;
-      else
-	program = new;
-      last=new;
-      break;
+    if(!scan_int(r, &type))
+      input_error(r, "unknown rule type");
+  }
+  r->list = NULL;
 
-    case TYPE_CHOICE:
-      new = read_choice(in);
-      if(!new)
-	error("erroneous choice rule");
-      if(last)
-	last->next = new;
-      else
-	program = new;
-      last=new;
-      break;
+  detach_reader(r);
 
-    case TYPE_INTEGRITY:
-      new = read_integrity(in);
-      if(!new)
-	error("erroneous integrity rule");
-      if(last)
-	last->next = new;
-      else
-	program = new;
-      last=new;
-      break;
+  return program;
+}
 
-    case TYPE_WEIGHT:
-      new = read_weight(in);
-      if(!new)
-	error("erroneous weight rule");
-      if(last)
-	last->next = new;
-      else
-	program = new;
-      last=new;
-      break;
+/* As read_program but the rules are stored in contiguous arrays */
 
-    case TYPE_OPTIMIZE:
-      new = read_optimize(in);
-      if(!new)
-	error("erroneous optimize statement");
-      if(last)
-	last->next = new;
-      else
-	program = new;
-      last=new;
-      break;
+RTAB *read_program_rtab(FILE *in)
+{
+  READER *r = attach_reader(in);
+  int type = 0;
+  RTAB *rules = NULL;
 
-    case TYPE_ORDERED:
-      error("ordered disjunctive rules are not supported");
-      break;
+  initialize_program();
+  r->arena = NULL;  /* No rules */
 
-    case TYPE_DISJUNCTIVE:
-      new = read_disjunctive(in);
-      if(!new)
-	error("erroneous disjunctive rule");
-      if(last)
-	last->next = new;
-      else
-	program = new;
-      last=new;
-      break;
+  if(r->map && worker_threads > 1)
+    rules = scan_program_rtab_parallel(r);
 
-    default:
-    case 0:
+  if(!rules) {
+    r->rules = rules = new_rtab(1024, 8192);  /* Released on failures */
+
+    if(!scan_int(r, &type))
+      input_error(r, "unknown rule type");
+
+    while(type != 0) {
+      (void) scan_rule_rtab(r, type, rules);  /* Unknown types skipped */
+
+      if(!scan_int(r, &type))
+	input_error(r, "unknown rule type");
+    }
+    r->rules = NULL;
+  }
+
+  detach_reader(r);
+
+  return rules;
+}
+
+/* Extend a table read before the rules (see convert_program) to cover
+   atoms up to max; extensions double in size and the last one is cut
+   down to the largest atom once the rules have been read */
+
+int cover_atoms(ATAB *table, int size, int max)
+{
+  int count = max-size > size ? max-size : size;
+
+  (void) extend_table(table, count, size);
+
+  return size+count;
+}
+
+/* The line "0" ending the rules of a mapped program: the first such
+   line provided that the next one is followed by "B+" (rules spread over
+   several lines may contain lines "0" of their own, and then the line
+   "0" following such a line is not followed by "B+") */
+
+char *find_end_of_rules(char *pos, char *end)
+{
+  char *rules = find_end_of_section(pos, end);
+  char *symbols = NULL;
+  char *next = NULL;
+
+  if(rules && (next = memchr(rules, '\n', end - rules)) != NULL &&
+     (symbols = find_end_of_section(next+1, end)) != NULL &&
+     (next = memchr(symbols, '\n', end - symbols)) != NULL &&
+     end - next > 2 && next[1] == 'B' && next[2] == '+')
+    return rules;
+
+  return NULL;
+}
+
+/* The largest atom of the lines "atom name" of a symbol section up to
+   the line "0" (only a hint for the size of the table) */
+
+int largest_named_atom(char *pos, char *end)
+{
+  int max = 0;
+
+  while(pos && pos < end) {
+    int atom = 0;
+
+    while(pos < end && ISSPACE(*pos))
+      pos++;
+    while(pos < end && ISDIGIT(*pos) && atom < INT_MAX/10)
+      atom = 10*atom + (*pos++ - '0');
+    if(atom == 0)
       break;
+    if(atom > max)
+      max = atom;
+
+    pos = memchr(pos, '\n', end - pos);
+    if(pos)
+      pos++;
+  }
+
+  return max;
+}
+
+/* Pass the rules read by r to write_rule one at a time (or just parse
+   them if out is NULL); the rules are read into a reused buffer and the
+   table is extended if atoms lie beyond it; the size of the table is
+   returned */
+
+int stream_rules(READER *r, RULE_ARENA *buffer, int style, FILE *out,
+		 ATAB *table)
+{
+  int type = 0;
+  int size = table ? table_size(table) : 0;
+  RULE *rule = NULL;
+
+  r->arena = buffer;
+
+  if(!scan_int(r, &type))
+    input_error(r, "unknown rule type");
+
+  while(type != 0) {
+    reset_rule_arena(buffer);
+    if((rule = scan_rule(r, type)) != NULL && out) {  /* Cf. read_program */
+      if(table && *(r->max) > size)
+	size = cover_atoms(table, size, *(r->max));
+      write_rule(style, out, rule, table);
     }
 
-    if(fscanf(in, " %i", &type) != 1)
-      error("unknown rule type");
+    if(!scan_int(r, &type))
+      input_error(r, "unknown rule type");
   }
-  
-  return program;
+
+  detach_reader(r);
+
+  return size;
+}
+
+/* Convert a program to the given style without keeping its rules in
+   memory; the table of atoms is returned (with the compute statement).
+   STYLE_SMODELS and STYLE_ASPIF need no names and the rules are written
+   as soon as they are read.  Otherwise the symbols are read first.  A
+   mapped file jumps to them over the rules: the table is sized by the
+   largest named atom and grows with the atoms of the rules while they
+   are written.  It is read again if the rules use fewer atoms, so that
+   it is the same as after read_program.  A compute statement with atoms
+   beyond the names is left to the parser.  Other seekable streams parse
+   the rules once to reach the symbols.  Only a pipe is read in as a
+   whole and written with write_program. */
+
+ATAB *convert_program(int style, FILE *in, FILE *out)
+{
+  RULE_ARENA *buffer = NULL;
+  ATAB *table = NULL;
+  READER *r = NULL;
+  char *section = NULL;
+  long start = ftell(in);
+  long symbols = -1;
+  long end = 0;
+  int names = (style != STYLE_SMODELS && style != STYLE_ASPIF);
+  int hint = 0;
+  int size = 0;
+
+  if(names && (start < 0 || fseek(in, start, SEEK_SET) != 0)) {
+    RULE *program = read_program(in);
+
+    table = read_symbols(in);
+    read_compute_statement(in, table);
+    write_program(style, out, program, table);
+    free_program(program);
+
+    return table;
+  }
+
+  initialize_program();
+  buffer = new_rule_arena();
+
+  if(!names) {
+    stream_rules(attach_reader(in), buffer, style, out, NULL);
+    table = read_symbols(in);
+    read_compute_statement(in, table);
+    free_rule_arena(buffer);
+
+    return table;
+  }
+
+  r = attach_reader(in);
+  if(r->map && (section = find_end_of_rules(r->pos, r->end)) != NULL &&
+     (size_t)(hint = largest_named_atom(section+1, r->end)) <= r->map_size) {
+    current_context->max_atom = hint;
+    r->pos = section+1;  /* Skip the final 0 */
+    symbols = (long)(r->pos - r->map);
+    detach_reader(r);
+
+    table = read_symbols(in);
+    read_compute_statement(in, table);
+    if(table->next) {  /* Atoms beyond the hint */
+      free_table(table);
+      table = NULL;
+      symbols = -1;
+      fseek(in, start, SEEK_SET);
+      r = attach_reader(in);
+    }
+  }
+
+  if(!table) {
+    initialize_program();
+    stream_rules(r, buffer, style, NULL, NULL);
+    table = read_symbols(in);
+    read_compute_statement(in, table);
+  }
+  end = ftell(in);
+
+  fseek(in, start, SEEK_SET);
+  initialize_program();
+  r = attach_reader(in);
+  size = stream_rules(r, buffer, style, out, table);
+  if(symbols >= 0 && ftell(in) != symbols)  /* Cf. find_end_of_rules */
+    input_error(r, "rules do not end before the symbols");
+
+  if(symbols >= 0 && current_context->max_atom < hint) {
+    free_table(table);
+    fseek(in, symbols, SEEK_SET);
+    table = read_symbols(in);
+    read_compute_statement(in, table);
+  } else {
+    if(symbols >= 0 && size > hint)  /* Grown by stream_rules */
+      truncate_table(table, current_context->max_atom);
+    fseek(in, end, SEEK_SET);
+  }
+
+  free_rule_arena(buffer);
+
+  return table;
 }
 
 /* ---------------------------- Read in symbols --------------------------- */
 
+/* Large symbol sections of memory-mapped files are split among worker
+   threads like rules: the names are interned concurrently and stored
+   directly in the table.  Atoms named twice (the last name counts) and
+   errors are left to the sequential reader. */
+
+void add_missing(CHUNK *chunk, int atom, SYMBOL *symbol)
+{
+  if(chunk->missing == chunk->missing_size) {
+    chunk->missing_size = chunk->missing_size ? 2*chunk->missing_size : 64;
+    chunk->atoms = (int *)realloc(chunk->atoms,
+				  chunk->missing_size*sizeof(int));
+    chunk->symbols = (SYMBOL **)realloc(chunk->symbols,
+				       chunk->missing_size*sizeof(SYMBOL *));
+  }
+  (chunk->atoms)[chunk->missing] = atom;
+  (chunk->symbols)[chunk->missing] = symbol;
+  chunk->missing++;
+
+  return;
+}
+
+#ifdef ATOMIC_CAS
+
+void scan_symbol_chunk(void *data, int index)
+{
+  CHUNKS *chunks = (CHUNKS *)data;
+  CHUNK *chunk = &(chunks->chunk)[index];
+  SYMBOL **names = chunks->table->names;
+  int count = chunks->table->count;
+  READER r;
+  jmp_buf abort;
+  int atom = 0;
+
+  open_chunk(&r, chunk, &abort);
+
+  if(setjmp(abort) == 0) {
+    while(scan_int(&r, &atom)) {
+      char *name = scan_name(&r);
+      SYMBOL *symbol = NULL;
+
+      if(atom == 0 || name == NULL || *name == '\0')
+	longjmp(abort, -1);
+      symbol = find_symbol(name);
+
+      if(atom > 0 && atom <= count) {
+	if(!ATOMIC_CAS(&names[atom], (SYMBOL *)NULL, symbol))
+	  longjmp(abort, -1);
+      } else
+	add_missing(chunk, atom, symbol);
+    }
+    if(skip_space(&r) != EOF)
+      longjmp(abort, -1);
+  } else
+    chunk->failed = -1;
+
+  close_chunk(&r, chunk);
+
+  return;
+}
+
+/* Name the atoms of a contiguous table and push the atoms outside it on
+   missing in the order of appearance; the reader is left at the final
+   0 (unless zero is returned for the sequential reader to take over) */
+
+int scan_symbols_parallel(READER *r, ATAB *table, ASTACK **missing)
+{
+  CHUNKS chunks;
+  char *end = NULL;
+  int concurrent = 0;
+  int failed = 0;
+  int i = 0;
+
+  if(r->end - r->pos < 2*CHUNK_MIN || table->next)
+    return 0;
+  if((end = find_end_of_section(r->pos, r->end)) == NULL)
+    return 0;
+
+  r->arena = NULL;  /* No rules */
+  if(!split_chunks(&chunks, r, end))
+    return 0;
+
+  chunks.table = table;
+  concurrent = concurrent_symbols(-1);
+  run_parallel(chunks.jobs, scan_symbol_chunk, &chunks);
+  (void) concurrent_symbols(concurrent);
+
+  for(i=0; i<chunks.jobs; i++) {
+    CHUNK *chunk = &(chunks.chunk)[i];
+    int j = 0;
+
+    if(chunk->failed)
+      failed = -1;
+    for(j=0; !failed && j<chunk->missing; j++)
+      r->missing = *missing =
+	push((chunk->atoms)[j], 0, (chunk->symbols)[j]->name, *missing);
+    if(chunk->atoms) {
+      free(chunk->atoms);
+      free(chunk->symbols);
+    }
+  }
+  free(chunks.chunk);
+
+  if(failed) {  /* Start afresh */
+    while(*missing) {
+      int atom = 0;
+
+      *missing = pop(&atom, NULL, NULL, *missing);
+    }
+    r->missing = NULL;
+    memset(table->names, 0, (table->count+1)*sizeof(SYMBOL *));
+    return 0;
+  }
+
+  r->pos = end;
+
+  return -1;
+}
+
+#endif
+
 ATAB *read_symbols(FILE *in)
 {
+  READER *r = attach_reader(in);
   int offset = 0;
-  ATAB *table = new_table(max_atom, offset);
+  ATAB *table = new_table(current_context->max_atom, offset);
   ASTACK *missing = NULL;
   int atom = 0;
 
-  if(fscanf(in, " %i", &atom) != 1)
-    error("missing symbol table entry");
+  r->table = table;
+
+#ifdef ATOMIC_CAS
+  if(r->map && worker_threads > 1)
+    (void) scan_symbols_parallel(r, table, &missing);
+#endif
+
+  if(!scan_int(r, &atom))
+    input_error(r, "missing symbol table entry");
 
   while(atom) {
     char *name = NULL;
+    SYMBOL *symbol = NULL;
 
-    if((name = read_string(in)) == NULL || strlen(name) == 0)
-      error("missing symbol name");
+    if((name = scan_name(r)) == NULL || strlen(name) == 0)
+      input_error(r, "missing symbol name");
 
-    if(!set_name(table, atom, name))
-      missing = push(atom, 0, name, missing);
+    symbol = find_symbol(name);  /* Copied once to the symbol table */
 
-    if(fscanf(in, " %i", &atom) != 1)
-      error("missing symbol table entry");
+    if(!set_symbol(table, atom, symbol))
+      r->missing = missing = push(atom, 0, symbol->name, missing);
+
+    if(!scan_int(r, &atom))
+      input_error(r, "missing symbol table entry");
   }
 
+  r->missing = NULL;  /* Released below */
+  detach_reader(r);
+
   /* Extend symbol table to cover missing atoms (a patch) */
 
   if(missing) { 
@@ -770,6 +2134,7 @@ ATAB *read_symbols(FILE *in)
 
 int read_compute_statement(FILE *in, ATAB *table)
 {
+  READER *r = attach_reader(in);
   int count = table->count;
   ASTACK *missing = NULL;
   int atom = 0;
@@ -778,66 +2143,72 @@ int read_compute_statement(FILE *in, ATAB *table)
 
   /* Read in the positive part (must exist) */
 
-  while((ch = fgetc(in)) != 'B' && ch != EOF);
-  while((ch = fgetc(in)) != '+' && ch != EOF);
+  while((ch = RGETC(r)) != 'B' && ch != EOF);
+  while((ch = RGETC(r)) != '+' && ch != EOF);
 
   if(ch == EOF)
-    error("missing (positive) compute statement");
+    input_error(r, "missing (positive) compute statement");
 
-  if(fscanf(in, " %i", &atom) != 1)
-    error("incomplete (positive) compute statement");
+  if(!scan_int(r, &atom))
+    input_error(r, "incomplete (positive) compute statement");
   
   while(atom) {
     if(!set_status(table, atom, MARK_TRUE))
-      missing = push(atom, MARK_TRUE, NULL, missing);
+      r->missing = missing = push(atom, MARK_TRUE, NULL, missing);
 
-    if(fscanf(in, " %i", &atom) != 1)
-      error("incomplete (positive) compute statement");
+    if(!scan_int(r, &atom))
+      input_error(r, "incomplete (positive) compute statement");
   }
 
   /* Read in the negative part (must exist) */
 
-  while((ch = fgetc(in)) != 'B' && ch != EOF);
-  while((ch = fgetc(in)) != '-' && ch != EOF);
+  while((ch = RGETC(r)) != 'B' && ch != EOF);
+  while((ch = RGETC(r)) != '-' && ch != EOF);
 
   if(ch == EOF)
-    error("missing (negative) compute statement");
+    input_error(r, "missing (negative) compute statement");
 
-  if(fscanf(in, " %i", &atom) != 1)
-    error("incomplete (negative) compute statement");
+  if(!scan_int(r, &atom))
+    input_error(r, "incomplete (negative) compute statement");
   
   while(atom) {
     if(!set_status(table, atom, MARK_FALSE))
-      missing = push(atom, MARK_FALSE, NULL, missing);
+      r->missing = missing = push(atom, MARK_FALSE, NULL, missing);
 
-    if(fscanf(in, " %i", &atom) != 1)
-      error("incomplete (negative) compute statement");
+    if(!scan_int(r, &atom))
+      input_error(r, "incomplete (negative) compute statement");
   }
 
   /* Check for a declaration of input atoms (optional) */
 
-  while(!isalnum(ch = fgetc(in)) && ch != EOF);
+  while(!isalnum(ch = RGETC(r)) && ch != EOF);
 
   if(ch == 'E') {
 
-    if(fscanf(in, " %i", &atom) != 1)
-      error("incomplete input specification");
+    if(!scan_int(r, &atom))
+      input_error(r, "incomplete input specification");
 
     while(atom) {
       if(!set_status(table, atom, MARK_INPUT))
-	missing = push(atom, MARK_INPUT, NULL, missing);
+	r->missing = missing = push(atom, MARK_INPUT, NULL, missing);
 
-      if(fscanf(in, " %i", &atom) != 1)
-	error("incomplete input specification");
+      if(!scan_int(r, &atom))
+	input_error(r, "incomplete input specification");
     }
 
-  } else if(ch != EOF)
-    ungetc(ch, in);
+  } else
+    RUNGETC(ch, r);
 
   /* Read in the number of models to be computed */
 
-  if(fscanf(in, " %i\n", &number) != 1)
-    error("missing number of models");
+  if(!scan_int(r, &number))
+    input_error(r, "missing number of models");
+
+  ch = skip_space(r);
+  RUNGETC(ch, r);
+
+  r->missing = NULL;  /* Released below */
+  detach_reader(r);
 
   /* Extend symbol table to cover missing atoms (a patch) */
 
@@ -848,8 +2219,8 @@ int read_compute_statement(FILE *in, ATAB *table)
     ASTACK *scan = missing->under;
 
     while(scan) {
-      if(scan->atom<min) min=atom;
-      if(scan->atom>max) max=atom;
+      if(scan->atom<min) min=scan->atom;
+      if(scan->atom>max) max=scan->atom;
       scan = scan->under;
     }
 
@@ -858,10 +2229,9 @@ int read_compute_statement(FILE *in, ATAB *table)
     while(missing) {
       int atom = 0;
       int status = 0;
-      int *statuses = piece->statuses;
 
       missing = pop(&atom, &status, NULL, missing);
-      statuses[atom-(min-1)] |= status;
+      set_piece_status(piece, atom-(min-1), status);
     }
   }
 
@@ -870,80 +2240,154 @@ int read_compute_statement(FILE *in, ATAB *table)
 
 /* --------------------- Support for DIMACS cnf format --------------------- */
 
-void read_literals(FILE *in, CLAUSE *clause, int weighted)
+/* Read the literals of a clause into the scratch area of the reader;
+   clause->neg and clause->pos refer to the scratch area afterwards */
+
+void scan_literals(READER *r, CLAUSE *clause, int weighted)
 {
   int literal = 0;
+  int cnt = 0;
+  int *neg = NULL;
+  int *pos = NULL;
+  int i = 0;
 
   if(weighted) {
     long weight = 0;
 
-    if(fscanf(in, " %li", &weight) !=1)
-      error("clause, missing weight");
+    if(!scan_long(r, &weight))
+      input_error(r, "clause, missing weight");
 
     if(weight<=0)
-      error("clause, non-positive weight");
+      input_error(r, "clause, non-positive weight");
     else
       clause->weight = weight;
   }
 
-  if(fscanf(in, " %i", &literal) != 1)
-    error("clause, missing literal");
-
-  /* The number of literals is not known in advance;
-     thus we make recursive calls until end of clause "0" is encountered */
+  /* The number of literals is not known in advance; thus literals are
+     collected in the scratch area of the reader until end of clause "0"
+     is encountered */
 
-  if(literal == 0) {
-    int pos_cnt = clause->pos_cnt;
-    int neg_cnt = clause->neg_cnt;
+  if(!scan_int(r, &literal))
+    input_error(r, "clause, missing literal");
 
-    if(pos_cnt) {
-      clause->pos = (int *)malloc(sizeof(int)*pos_cnt);
+  while(literal) {
+    if(cnt == r->lits_size) {
+      r->lits_size = r->lits_size ? 2*r->lits_size : 64;
+      r->lits = (int *)realloc(r->lits, r->lits_size*sizeof(int));
     }
+    (r->lits)[cnt++] = literal;
 
-    if(neg_cnt) {
-      clause->neg = (int *)malloc(sizeof(int)*neg_cnt);
-    }
+    if(literal < 0)
+      clause->neg_cnt++;
+
+    if(!scan_int(r, &literal))
+      input_error(r, "clause, missing literal");
+  }
+  clause->pos_cnt = cnt - clause->neg_cnt;
 
-  } else if(literal > 0) {
-    int i = clause->pos_cnt++;
-    
-    read_literals(in, clause, 0);
-    (clause->pos)[i] = literal;
+  /* Negative and positive literals are separated (in this order) after
+     the literals read */
 
-  } else { /* literal < 0 */
-    int i = clause->neg_cnt++;
-    
-    read_literals(in, clause, 0);
-    (clause->neg)[i] = -literal;
+  if(2*cnt > r->lits_size) {
+    r->lits_size = 2*cnt;
+    r->lits = (int *)realloc(r->lits, r->lits_size*sizeof(int));
+  }
 
+  neg = &(r->lits)[cnt];
+  pos = &neg[clause->neg_cnt];
+  clause->neg = neg;
+  clause->pos = pos;
+
+  for(i=0; i<cnt; i++) {
+    literal = (r->lits)[i];
+    if(literal < 0)
+      *(neg++) = -literal;
+    else
+      *(pos++) = literal;
   }
 
   return;
 }
 
-RULE *read_clause(FILE *in, int weighted)
+void read_literals(READER *r, CLAUSE *clause, int weighted)
 {
-  RULE *new = (RULE *)malloc(sizeof(RULE));
-  CLAUSE *clause = (CLAUSE *)malloc(sizeof(CLAUSE));
+  int cnt = 0;
+  int *table = NULL;
+
+  scan_literals(r, clause, weighted);
+
+  /* Negative and positive literals share one table (in this order) */
 
+  cnt = clause->neg_cnt + clause->pos_cnt;
+
+  if(cnt) {
+    table = (int *)RALLOC(r, sizeof(int)*cnt);
+    memcpy(table, clause->neg, sizeof(int)*cnt);
+    clause->neg = table;
+    clause->pos = &table[clause->neg_cnt];
+  } else {
+    clause->neg = NULL;
+    clause->pos = NULL;
+  }
+
+  return;
+}
+
+RULE *scan_clause(READER *r, int weighted)
+{
+  RULE *new = NULL;
+  CLAUSE clause;
+
+  clause.pos_cnt = 0;
+  clause.pos = NULL;
+
+  clause.neg_cnt = 0;
+  clause.neg = NULL;
+
+  clause.weight = 0;
+
+  /* Nothing is allocated before the clause has been read successfully */
+
+  read_literals(r, &clause, weighted);
+
+  new = (RULE *)RALLOC(r, sizeof(RULE));
   new->type = TYPE_CLAUSE;
-  new->data.clause = clause;
+  new->arena = r->arena ? RULE_IN_ARENA : 0;
+  new->data.clause = (CLAUSE *)RALLOC(r, sizeof(CLAUSE));
+  *(new->data.clause) = clause;
   new->next = NULL;
+  r->partial_cnt = 0;  /* Cf. scan_rule */
+
+  return new;
+}
 
-  clause->pos_cnt = 0;
-  clause->pos = NULL;
+RULE *read_clause(FILE *in, int weighted)
+{
+  READER *r = resume_reader(in);
+  RULE *clause = scan_clause(r, weighted);
 
-  clause->neg_cnt = 0;
-  clause->neg = NULL;
+  finish_reader(r);
 
-  clause->weight = 0;
+  return clause;
+}
 
-  read_literals(in, clause, weighted);
+/* Cf. read_rule_reusing */
 
-  return new;
+RULE *read_clause_reusing(FILE *in, int weighted, RULE_ARENA *buffer)
+{
+  READER *r = resume_reader(in);
+  RULE *clause = NULL;
+
+  reset_rule_arena(buffer);
+  r->arena = buffer;
+  clause = scan_clause(r, weighted);
+
+  finish_reader(r);
+
+  return clause;
 }
 
-ATAB *initialize_cnf(FILE *in, int *clauses, int *weighted)
+ATAB *scan_cnf_header(READER *r, int *clauses, int *weighted)
 {
   int ch = 0;
   int vars = 0;
@@ -952,140 +2396,398 @@ ATAB *initialize_cnf(FILE *in, int *clauses, int *weighted)
   long max = 0;
   int items = 0;
 
-  while((ch = getc(in)) == 'c')
-    while(ch != '\n')
-      ch = getc(in);
+  while((ch = RGETC(r)) == 'c')
+    while(ch != '\n' && ch != EOF)
+      ch = RGETC(r);
 
   if(ch != 'p')
     failed = -1;
   else
-    ch = getc(in);
+    ch = RGETC(r);
 
   if(ch != ' ')
     failed = -1;
   else
-    ch = getc(in);
+    ch = RGETC(r);
 
   if(ch == 'w')
     *weighted = -1;
   else if(ch == 'c')
-    ungetc(ch, in);
+    RUNGETC(ch, r);
   else
     failed = -1;
 
+  /* Match "cnf %i %i %li\n" or "cnf %i %i\n" as fscanf would */
+
   if(!failed) {
-    if(*weighted)
-      items = fscanf(in, "cnf %i %i %li\n", &vars, clauses, &max);
-    else
-      items = fscanf(in, "cnf %i %i\n", &vars, clauses);
+    char *keyword = "cnf";
+
+    while(*keyword && (ch = RGETC(r)) == *keyword)
+      keyword++;
+
+    if(*keyword == '\0') {
+      if(scan_int(r, &vars))
+	items++;
+      if(items == 1 && scan_int(r, clauses))
+	items++;
+      if(items == 2 && *weighted && scan_long(r, &max))
+	items++;
+      if(items == (*weighted ? 3 : 2)) {
+	ch = skip_space(r);
+	RUNGETC(ch, r);
+      }
+    } else
+      RUNGETC(ch, r);
   }
 
   if((!*weighted && items !=2) || (*weighted && (items<2 || items>3)) || failed)
-    error("DIMACS cnf/wcnf format: missing/invalid problem line");
+    input_error(r, "DIMACS cnf/wcnf format: missing/invalid problem line");
 
   table = new_table(vars, 0);
+  r->table = table;
   if(*weighted && items == 3)
-    max_weight = max;
+    max_weight = current_context->max_weight = max;
 
-  while((ch = getc(in)) == 'c') {
+  while((ch = RGETC(r)) == 'c') {
     int atom = 0;
     char *name = NULL;
 
-    if((ch = getc(in)) == ' ')
-      if(fscanf(in, " %i", &atom) == 1)
-	if((name = read_string(in)) != NULL)
+    if((ch = RGETC(r)) == ' ')
+      if(scan_int(r, &atom))
+	if((name = scan_string(r)) != NULL) {
 	  set_name(table, atom, name);
+	  free(name);
+	}
 
-    while(ch != '\n')
-      ch = getc(in);
+    while(ch != '\n' && ch != EOF)
+      ch = RGETC(r);
   }
 
-  ungetc(ch, in);
+  RUNGETC(ch, r);
+
+  return table;
+}
+
+ATAB *initialize_cnf(FILE *in, int *clauses, int *weighted)
+{
+  READER *r = attach_reader(in);
+  ATAB *table = scan_cnf_header(r, clauses, weighted);
+
+  detach_reader(r);
 
   /* Ready to read in clauses one by one using read_clause */
   
   return table;
 }
 
-RULE *read_cnf(FILE *in, ATAB **table, int *weighted)
+/* Clauses of large memory-mapped files are parsed in parallel. A chunk
+   is accepted only if it consists of complete clauses; clauses spanning
+   chunks, syntax errors, and a wrong number of clauses are left to the
+   sequential parser. */
+
+void scan_clause_chunk(void *data, int index)
 {
+  CHUNKS *chunks = (CHUNKS *)data;
+  CHUNK *chunk = &(chunks->chunk)[index];
+  READER r;
+  jmp_buf abort;
   int ch = 0;
-  int vars = 0, clauses = 0;
-  int atom = 0;
-  int log = 1;
-  int failed = 0;
-  long max = 0;
-  int items = 0;
 
-  RULE *cnf = NULL;
-  RULE *new = NULL;
-  RULE *last = NULL;
+  open_chunk(&r, chunk, &abort);
 
-  SYMBOL **names = NULL;
-  int *statuses = NULL;
+  if(setjmp(abort) == 0) {
+    while((ch = skip_space(&r)) != EOF) {
+      RUNGETC(ch, &r);
+      add_to_chunk(chunk, scan_clause(&r, chunks->weighted), r.pos);
+    }
+  } else
+    chunk->failed = -1;
 
-  while((ch = getc(in)) == 'c')
-    while(ch != '\n')
-      ch = getc(in);
+  close_chunk(&r, chunk);
 
-  if(ch != 'p')
-    failed = -1;
-  else
-    ch = getc(in);
+  return;
+}
 
-  if(ch != ' ')
-    failed = -1;
-  else
-    ch = getc(in);
+RULE *scan_cnf_parallel(READER *r, int clauses, int weighted)
+{
+  CHUNKS chunks;
 
-  if(ch == 'w')
-    *weighted = -1;
-  else if(ch == 'c')
-    ungetc(ch, in);
-  else
-    failed = -1;
+  if(!split_chunks(&chunks, r, r->end))
+    return NULL;
 
-  if(!failed) {
-    if(*weighted)
-      items = fscanf(in, "cnf %i %i %li\n", &vars, &clauses, &max);
-    else
-      items = fscanf(in, "cnf %i %i\n", &vars, &clauses);
-  }
+  chunks.weighted = weighted;
+  run_parallel(chunks.jobs, scan_clause_chunk, &chunks);
 
-  if((!*weighted && items !=2) || (*weighted && (items<2 || items>3)) || failed)
-    error("DIMACS cnf/wcnf format: missing/invalid problem line");
-    
-  *table = new_table(vars, 0);
-  names = (*table)->names;
-  statuses = (*table)->statuses;
-  if(*weighted && items == 3)
-    max_weight = max;
+  return join_chunks(&chunks, r, clauses);
+}
 
-  while((ch = getc(in)) == 'c') {
-    int atom = 0;
-    char *name = NULL;
+RULE *read_cnf(FILE *in, ATAB **table, int *weighted)
+{
+  READER *r = attach_reader(in);
+  int clauses = 0;
 
-    if((ch = getc(in)) == ' ')
-      if(fscanf(in, " %i", &atom) == 1)
-	if((name = read_string(in)) != NULL)
-	  set_name(*table, atom, name);
+  RULE *cnf = NULL;
+  RULE *new = NULL;
+  RULE *last = NULL;
 
-    while(ch != '\n')
-      ch = getc(in);
-  }
+  *table = scan_cnf_header(r, &clauses, weighted);
 
-  ungetc(ch, in);
+  if(r->map && worker_threads > 1 && clauses > 0)
+    if((cnf = scan_cnf_parallel(r, clauses, *weighted)) != NULL)
+      clauses = 0;
 
   while((clauses--)>0) {
-    new = read_clause(in, *weighted);
+    new = scan_clause(r, *weighted);
     if(cnf == NULL) {
       cnf = new;
       last = cnf;
+      if(!r->arena)
+	r->list = cnf;  /* Released on failures */
     } else {
       last->next = new;
       last = new;
     }
   }  
+  r->list = NULL;
+
+  detach_reader(r);
 
   return cnf;
 }
+
+/* As read_cnf but the clauses are stored in contiguous arrays */
+
+RTAB *read_cnf_rtab(FILE *in, ATAB **table, int *weighted)
+{
+  READER *r = attach_reader(in);
+  int clauses = 0;
+  RTAB *rules = NULL;
+  RULE *cnf = NULL;
+
+  r->arena = NULL;  /* Clauses are temporary */
+  *table = scan_cnf_header(r, &clauses, weighted);
+
+  if(r->map && worker_threads > 1 && clauses > 0)
+    if((cnf = scan_cnf_parallel(r, clauses, *weighted)) != NULL) {
+      rules = program_to_rtab(cnf);
+      free_program(cnf);
+      detach_reader(r);
+      return rules;
+    }
+
+  r->rules = rules =  /* Released on failures */
+    new_rtab(clauses < (1<<20) ? clauses : (1<<20), 4096);
+
+  while((clauses--)>0) {
+    CLAUSE clause;
+
+    clause.pos_cnt = 0;
+    clause.neg_cnt = 0;
+    clause.weight = 0;
+
+    scan_literals(r, &clause, *weighted);
+    (void) add_rtab(rules, TYPE_CLAUSE, 0, NULL,
+		    clause.neg_cnt, clause.neg, clause.pos_cnt, clause.pos,
+		    NULL, clause.weight);
+  }
+
+  r->rules = NULL;
+  detach_reader(r);
+
+  return rules;
+}
+
+/* ------------------------ Reading in a context -------------------------- */
+
+/* The following are as above but operate on the given context (see
+   context.h) rather than on the current one */
+
+RULE *read_program_ctx(CONTEXT *context, FILE *in)
+{
+  CONTEXT *previous = use_context(context);
+  RULE *program = read_program(in);
+
+  (void) use_context(previous);
+
+  return program;
+}
+
+ATAB *read_symbols_ctx(CONTEXT *context, FILE *in)
+{
+  CONTEXT *previous = use_context(context);
+  ATAB *table = read_symbols(in);
+
+  (void) use_context(previous);
+
+  return table;
+}
+
+int read_compute_statement_ctx(CONTEXT *context, FILE *in, ATAB *table)
+{
+  CONTEXT *previous = use_context(context);
+  int number = read_compute_statement(in, table);
+
+  (void) use_context(previous);
+
+  return number;
+}
+
+RULE *read_cnf_ctx(CONTEXT *context, FILE *in, ATAB **table, int *weighted)
+{
+  CONTEXT *previous = use_context(context);
+  RULE *cnf = read_cnf(in, table, weighted);
+
+  (void) use_context(previous);
+
+  return cnf;
+}
+
+/* ------------------------ Reading with a status ------------------------- */
+
+/* The following are as above but the results are passed through the
+   last arguments and the code of a failure (see context.h) or ERROR_NONE
+   is returned instead of exiting; the message and the position of the
+   failure are found in the current context.  Partially read rules and
+   tables are released on failures: rules allocated with malloc are
+   tracked by the reader, and an arena in use receives the rules from an
+   arena of their own on success.  The position of the stream is undefined after failures
+   and the table given to read_compute_statement_status may have been
+   updated partially. */
+
+/* Release the reader of a stream after a failure */
+
+void discard_input(FILE *in)
+{
+  READER *r = current_context->readers;
+
+  while(r && r->file != in)
+    r = r->next;
+
+  if(r) {
+    if(r->table)
+      free_table(r->table);
+    while(r->missing) {
+      int atom = 0;
+
+      r->missing = pop(&atom, NULL, NULL, r->missing);
+    }
+    release_reader(r);
+  }
+
+  return;
+}
+
+int read_program_status(FILE *in, RULE **program)
+{
+  RULE_ARENA *arena = get_rule_arena();
+  RULE_ARENA *buffer = arena ? new_rule_arena() : NULL;
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  *program = NULL;
+  if(buffer)
+    (void) use_rule_arena(buffer);
+
+  if(setjmp(abort) == 0) {
+    *program = read_program(in);
+    if(buffer)
+      merge_rule_arenas(arena, buffer);
+  } else {
+    code = current_context->error;
+    discard_input(in);
+    if(buffer)
+      free_rule_arena(buffer);
+  }
+
+  (void) use_rule_arena(arena);
+  (void) catch_errors(previous);
+
+  return code;
+}
+
+int read_symbols_status(FILE *in, ATAB **table)
+{
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  *table = NULL;
+
+  if(setjmp(abort) == 0)
+    *table = read_symbols(in);
+  else {
+    code = current_context->error;
+    discard_input(in);
+  }
+  (void) catch_errors(previous);
+
+  return code;
+}
+
+int read_compute_statement_status(FILE *in, ATAB *table, int *number)
+{
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  *number = 0;
+
+  if(setjmp(abort) == 0)
+    *number = read_compute_statement(in, table);
+  else {
+    code = current_context->error;
+    discard_input(in);
+  }
+  (void) catch_errors(previous);
+
+  return code;
+}
+
+int read_cnf_status(FILE *in, ATAB **table, int *weighted, RULE **cnf)
+{
+  RULE_ARENA *arena = get_rule_arena();
+  RULE_ARENA *buffer = arena ? new_rule_arena() : NULL;
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  *table = NULL;
+  *cnf = NULL;
+  if(buffer)
+    (void) use_rule_arena(buffer);
+
+  if(setjmp(abort) == 0) {
+    *cnf = read_cnf(in, table, weighted);
+    if(buffer)
+      merge_rule_arenas(arena, buffer);
+  } else {
+    code = current_context->error;
+    *table = NULL;  /* Released with the reader */
+    discard_input(in);
+    if(buffer)
+      free_rule_arena(buffer);
+  }
+
+  (void) use_rule_arena(arena);
+  (void) catch_errors(previous);
+
+  return code;
+}
+
+/* ----------------------------- Miscellaneous ---------------------------- */
+
+long get_max_weight()
+{
+  return current_context->max_weight;
+}
+
+/* Release the readers of the current context (see free_context) */
+
+void release_readers()
+{
+  while(current_context->readers)
+    release_reader(current_context->readers);
+
+  return;
+}
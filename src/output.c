@@ -27,14 +27,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <setjmp.h>
 
 #include "version.h"
 #include "symbol.h"
 #include "atom.h"
 #include "rule.h"
 #include "io.h"
-
-int priority = 0; /* Priority level for ASPIF translation */
+#include "thread.h"
+#include "context.h"
 
 /* --------------------- Print version information ------------------------- */
 
@@ -45,32 +46,205 @@ void _version_output_c()
 	   "$Revision: 1.37 $");
 }
 
-/* ----------------------- Output a logic program -------------------------- */
+/* ------------------------- Buffered output ------------------------------- */
 
-void write_name(FILE *out, SYMBOL *s, char *prefix, char *postfix)
+/* Output is collected in a buffer of the writer and passed on to the
+   stream in large blocks; the buffer is flushed before returning from
+   every exported write_* routine so that output produced by the
+   callers interleaves as before.  A writer without a stream collects
+   its output in memory (see write_parallel). */
+
+#define WRITER_SIZE (1<<16)
+
+typedef struct writer {
+  FILE *out;          /* Destination stream (NULL for memory) */
+  char *buf;          /* Start of the buffer */
+  char *pos;          /* Next free position */
+  char *end;          /* End of the buffer */
+  int *priority;      /* Counter for ASPIF priorities */
+  jmp_buf *abort;     /* Where to go on errors (if set) */
+  char space[WRITER_SIZE];
+} WRITER;
+
+void open_writer(WRITER *w, FILE *out)
 {
-  char *name = NULL;
+  w->out = out;
+  w->buf = w->space;
+  w->pos = w->buf;
+  w->end = &w->buf[WRITER_SIZE];
+  w->priority = &(current_context->priority);
+  w->abort = NULL;
 
-  if(s)
-    name = s->name;
-  if(prefix)
-    fputs(prefix, out);
-  if(name) {
-    while(*name != '(' && *name != '\0') {
-      fputc(*name, out); name++;
+  return;
+}
+
+void flush_writer(WRITER *w)
+{
+  if(w->out && w->pos != w->buf) {
+    fwrite(w->buf, 1, w->pos - w->buf, w->out);
+    w->pos = w->buf;
+  }
+  return;
+}
+
+void close_writer(WRITER *w)
+{
+  flush_writer(w);
+  if(w->buf != w->space)
+    free(w->buf);
+
+  return;
+}
+
+/* Called before reporting an error */
+
+void abort_writer(WRITER *w)
+{
+  if(w->abort)
+    longjmp(*(w->abort), 1);
+  flush_writer(w);
+
+  return;
+}
+
+/* Make room for len more characters: streams are flushed and memory
+   buffers grow */
+
+void make_room(WRITER *w, size_t len)
+{
+  size_t used = w->pos - w->buf;
+  size_t size = w->end - w->buf;
+  char *buf = NULL;
+
+  if(w->out) {
+    flush_writer(w);
+    return;
+  }
+
+  while(size-used < len)
+    size *= 2;
+
+  if(w->buf == w->space) {
+    buf = (char *)malloc(size);
+    if(buf)
+      memcpy(buf, w->buf, used);
+  } else
+    buf = (char *)realloc(w->buf, size);
+
+  if(!buf) {
+    abort_writer(w);
+    failure(ERROR_MEMORY, "out of memory!");
+  }
+  w->buf = buf;
+  w->pos = &buf[used];
+  w->end = &buf[size];
+
+  return;
+}
+
+void put_block(WRITER *w, char *str, size_t len)
+{
+  if((size_t)(w->end - w->pos) < len) {
+    make_room(w, len);
+    if((size_t)(w->end - w->pos) < len) {  /* Too long for a stream */
+      fwrite(str, 1, len, w->out);
+      return;
     }
+  }
+  memcpy(w->pos, str, len);
+  w->pos += len;
+
+  return;
+}
+
+#define PUTS(w, str) put_block((w), (str), strlen(str))
+
+#define PUTC(w, ch) do { \
+    if((w)->pos == (w)->end) make_room((w), 1); \
+    *((w)->pos)++ = (ch); \
+  } while(0)
+
+/* Decimal numbers are produced two digits at a time */
+
+char digit_pairs[] =
+  "00010203040506070809101112131415161718192021222324"
+  "25262728293031323334353637383940414243444546474849"
+  "50515253545556575859606162636465666768697071727374"
+  "75767778798081828384858687888990919293949596979899";
+
+#define NUMBER_SIZE 24
+
+void put_long(WRITER *w, long number)
+{
+  char digits[NUMBER_SIZE];
+  char *last = &digits[NUMBER_SIZE];
+  char *first = last;
+  unsigned long value = (unsigned long)number;
+
+  if(number < 0)
+    value = 0UL - value;
+
+  while(value >= 100) {
+    unsigned long pair = value % 100;
+
+    value /= 100;
+    first -= 2;
+    memcpy(first, &digit_pairs[2*pair], 2);
+  }
+  if(value >= 10) {
+    first -= 2;
+    memcpy(first, &digit_pairs[2*value], 2);
+  } else
+    *(--first) = '0' + (char)value;
+
+  if(number < 0)
+    *(--first) = '-';
+
+  put_block(w, first, last - first);
+
+  return;
+}
+
+#define put_int(w, number) put_long((w), (long)(number))
+
+/* ----------------------- Output a logic program -------------------------- */
+
+/* A name is written in (at most) three blocks: the postfix goes before
+   the arguments of the name (see SYMBOL.split) */
+
+void put_name(WRITER *w, SYMBOL *s, char *prefix, int prefix_len,
+	      char *postfix, int postfix_len)
+{
+  if(prefix)
+    put_block(w, prefix, prefix_len);
+  if(s && s->name) {
+    put_block(w, s->name, s->split);
     if(postfix)
-      fputs(postfix, out);
-    while(*name != '\0') {
-      fputc(*name, out); name++;
-    }
+      put_block(w, postfix, postfix_len);
+    put_block(w, &(s->name)[s->split], s->length - s->split);
   } else {
-    fprintf(out, "NULL");
+    PUTS(w, "NULL");
     if(postfix)
-      fputs(postfix, out);
+      put_block(w, postfix, postfix_len);
   }
 }
 
+#define put_atom_name(w, s, piece) \
+  put_name((w), (s), (piece)->prefix, (piece)->prefix_len, \
+	   (piece)->postfix, (piece)->postfix_len)
+
+void write_name(FILE *out, SYMBOL *s, char *prefix, char *postfix)
+{
+  WRITER w;
+
+  open_writer(&w, out);
+  put_name(&w, s, prefix, prefix ? strlen(prefix) : 0,
+	   postfix, postfix ? strlen(postfix) : 0);
+  flush_writer(&w);
+
+  return;
+}
+
 int atomlen(int atom, ATAB *table)
 {
   ATAB *piece = find_atom(table, atom);
@@ -85,27 +259,20 @@ int atomlen(int atom, ATAB *table)
     /* The length is calculated as if printed in STYLE_READABLE */
 
     if(name) {
-      char *str = name->name;
-      if(str) {
-	if(piece->prefix)
-	  len += strlen(piece->prefix);
-	len += strlen(str);
-	if(piece->postfix)
-	  len += strlen(piece->postfix);
-      } else
+      if(name->name)
+	len = piece->prefix_len + name->length + piece->postfix_len;
+      else
 	len = strlen("NULL");
     } else
       len = 1+log10i(atom+shift); /* Preceded by underscore */
 
-  } else {
-    fprintf(stderr, "%s: entry _%i out of table\n", program_name, atom);
-    exit(-1);
-  }
+  } else
+    failure(ERROR_TABLE, "entry _%i out of table", atom);
 
   return len;
 }
 
-void write_atom(int style, FILE *out, int atom, ATAB *table)
+void put_atom(int style, WRITER *w, int atom, ATAB *table)
 {
   ATAB *piece = find_atom(table, atom);
 
@@ -121,51 +288,102 @@ void write_atom(int style, FILE *out, int atom, ATAB *table)
     case STYLE_DIMACS:
 
       if(name)
-	write_name(out, name, piece->prefix, piece->postfix);
-      else
-	fprintf(out, "_%i", atom+shift);
+	put_atom_name(w, name, piece);
+      else {
+	PUTC(w, '_');
+	put_int(w, atom+shift);
+      }
       break;
 
     case STYLE_SMODELS:
-      fputs(" ", out);
+      PUTC(w, ' ');
     case STYLE_ASPIF:
-      fprintf(out, "%i", atom+shift);
+      put_int(w, atom+shift);
       break;
 
     case STYLE_DLV:
       if(name)
-	write_name(out, name, piece->prefix, piece->postfix);
-      else
-	fprintf(out, "int%i", atom+shift);
+	put_atom_name(w, name, piece);
+      else {
+	PUTS(w, "int");
+	put_int(w, atom+shift);
+      }
       break;
 
     default:
-      fprintf(stderr, "%s: unknown style %i for _%i\n",
-	      program_name, style, atom);
-      exit(-1);
+      abort_writer(w);
+      failure(ERROR_UNSUPPORTED, "unknown style %i for _%i", style, atom);
     }
+  } else if(!table && (style == STYLE_SMODELS || style == STYLE_ASPIF)) {
+    /* Without a table atoms are written as such (see convert_program) */
+
+    if(style == STYLE_SMODELS)
+      PUTC(w, ' ');
+    put_int(w, atom);
   } else {
-    fprintf(stderr, "%s: entry _%i out of table\n", program_name, atom);
-    exit(-1);
+    abort_writer(w);
+    failure(ERROR_TABLE, "entry _%i out of table", atom);
   }
 
   return;
 }
 
-void write_atom_list(int style, FILE *out, int cnt, int *atoms, ATAB *table)
+void write_atom(int style, FILE *out, int atom, ATAB *table)
+{
+  WRITER w;
+
+  open_writer(&w, out);
+  put_atom(style, &w, atom, table);
+  flush_writer(&w);
+
+  return;
+}
+
+/* The name of an atom (in the given style) for messages */
+
+void atom_text(char *text, void (*put)(int, WRITER *, int, ATAB *),
+	       int style, int atom, ATAB *table)
+{
+  WRITER w;
+  size_t len = 0;
+
+  open_writer(&w, NULL);
+  put(style, &w, atom, table);
+  len = w.pos - w.buf;
+  if(len > ERROR_SIZE-1)
+    len = ERROR_SIZE-1;
+  memcpy(text, w.buf, len);
+  text[len] = '\0';
+  close_writer(&w);
+
+  return;
+}
+
+void put_atom_list(int style, WRITER *w, int cnt, int *atoms, ATAB *table)
 {
   int i = 0;
 
   for(i=0; i<cnt; i++) {
     if(cnt>1 && i>0)
-      fprintf(out, ", ");
-    write_atom(style, out, atoms[i], table);
+      PUTS(w, ", ");
+    put_atom(style, w, atoms[i], table);
   }
 
   return;
 }
 
-void write_other_atom(int style, FILE *out, int atom, ATAB *table)
+void write_atom_list(int style, FILE *out, int cnt, int *atoms, ATAB *table)
+{
+  WRITER w;
+
+  open_writer(&w, out);
+  put_atom_list(style, &w, cnt, atoms, table);
+  flush_writer(&w);
+
+  return;
+}
+
+void put_other_atom(int style, WRITER *w, int atom, ATAB *table)
 {
   ATAB *piece = find_atom(table, atom);
 
@@ -175,26 +393,37 @@ void write_other_atom(int style, FILE *out, int atom, ATAB *table)
     int offset = piece->offset;
 
     if(!other || !others || !others[atom-offset]) {
-      fprintf(stderr, "%s: missing cross reference for ",
-	      program_name);
-      write_atom(STYLE_READABLE, stderr, atom, table);
-      fprintf(stderr, "\n");
-      exit(-1);
+      char name[ERROR_SIZE];
+
+      abort_writer(w);
+      atom_text(name, put_atom, STYLE_READABLE, atom, table);
+      failure(ERROR_TABLE, "missing cross reference for %s", name);
     } else
-      write_atom(style, out, others[atom-offset], other);
+      put_atom(style, w, others[atom-offset], other);
 
   } else {
-    fprintf(stderr, "%s: entry _%i out of table\n", program_name, atom);
-    exit(-1);
+    abort_writer(w);
+    failure(ERROR_TABLE, "entry _%i out of table", atom);
   }
 
   return;
 }
 
-void write_literal_list(int style, FILE *out, char *separator,
-			int pos_cnt, int *pos,
-			int neg_cnt, int *neg,
-			int *weight, int ones, ATAB *table)
+void write_other_atom(int style, FILE *out, int atom, ATAB *table)
+{
+  WRITER w;
+
+  open_writer(&w, out);
+  put_other_atom(style, &w, atom, table);
+  flush_writer(&w);
+
+  return;
+}
+
+void put_literal_list(int style, WRITER *w, char *separator,
+		      int pos_cnt, int *pos,
+		      int neg_cnt, int *neg,
+		      int *weight, int ones, ATAB *table)
 {
   int *scan = NULL;
   int *last = NULL;
@@ -204,57 +433,65 @@ void write_literal_list(int style, FILE *out, char *separator,
   for(scan = neg, last = &neg[neg_cnt];
       scan != last; ) {
     if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-      fprintf(out, "not ");
+      PUTS(w, "not ");
     if(style == STYLE_ASPIF)
-      fputs("-", out);
-    write_atom(style, out, *scan, table);
+      PUTC(w, '-');
+    put_atom(style, w, *scan, table);
     if(wscan) {
-      if(style == STYLE_READABLE)
-	fprintf(out, "=%i", *(wscan++));
-      else if(style == STYLE_ASPIF)
-	fprintf(out, " %i", *(wscan++));
+      if(style == STYLE_READABLE) {
+	PUTC(w, '=');
+	put_int(w, *(wscan++));
+      } else if(style == STYLE_ASPIF) {
+	PUTC(w, ' ');
+	put_int(w, *(wscan++));
+      }
     }
     if(style == STYLE_ASPIF && ones)
-      fputs(" 1", out);
+      PUTS(w, " 1");
     scan++;
     if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
       if(scan != last || pos_cnt)
-	fprintf(out, "%s", separator);
+	PUTS(w, separator);
     if(style == STYLE_ASPIF)
       if(scan != last || pos_cnt)
-	fputs(" ", out);
+	PUTC(w, ' ');
   }
 
   for(scan = pos, last = &pos[pos_cnt];
       scan != last; ) {
-    write_atom(style, out, *scan, table);
+    put_atom(style, w, *scan, table);
     if(wscan) {
-      if (style == STYLE_READABLE)
-	fprintf(out, "=%i", *(wscan++));
-      else if(style == STYLE_ASPIF)
-	fprintf(out, " %i", *(wscan++));
+      if (style == STYLE_READABLE) {
+	PUTC(w, '=');
+	put_int(w, *(wscan++));
+      } else if(style == STYLE_ASPIF) {
+	PUTC(w, ' ');
+	put_int(w, *(wscan++));
+      }
     }
     if(style == STYLE_ASPIF && ones)
-      fputs(" 1", out);
+      PUTS(w, " 1");
     scan++;
     if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
       if(scan != last)
-	fprintf(out, "%s", separator);
+	PUTS(w, separator);
     if(style == STYLE_ASPIF)
       if(scan != last)
-	fputs(" ", out);
+	PUTC(w, ' ');
   }
 
   if(wscan && (style == STYLE_SMODELS))
-    while(wscan != wlast)
-      fprintf(out, " %i", *(wscan++));
+    while(wscan != wlast) {
+      PUTC(w, ' ');
+      put_int(w, *(wscan++));
+    }
 
   return;
 }
 
 /* ----------------------- Different types of rules ------------------------ */
 
-void write_basic(int style, FILE *out, RULE *rule, ATAB *table)
+void put_basic(int style, WRITER *w, RULE *rule, ATAB *table)
 {
   int *scan = NULL;
   int *last = NULL;
@@ -264,40 +501,46 @@ void write_basic(int style, FILE *out, RULE *rule, ATAB *table)
   BASIC_RULE *basic = rule->data.basic;
 
   if(style == STYLE_SMODELS)
-    fprintf(out, "1");
+    PUTC(w, '1');
   else if(style == STYLE_ASPIF)
-    fprintf(out, "1 0 1 ");
+    PUTS(w, "1 0 1 ");
     
-  write_atom(style, out, basic->head, table);
+  put_atom(style, w, basic->head, table);
 
   pos_cnt = basic->pos_cnt;
   neg_cnt = basic->neg_cnt;
 
-  if(style == STYLE_SMODELS)
-    fprintf(out, " %i %i", (pos_cnt+neg_cnt), neg_cnt);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, " 0 %i ", pos_cnt+neg_cnt);
+  if(style == STYLE_SMODELS) {
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+    put_int(w, neg_cnt);
+  } else if(style == STYLE_ASPIF) {
+    PUTS(w, " 0 ");
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+  }
     
   if(pos_cnt || neg_cnt) {
     if(style == STYLE_READABLE || style == STYLE_GNT ||
        style == STYLE_DLV)
-      fprintf(out, " :- ");
+      PUTS(w, " :- ");
 
-    write_literal_list(style, out, ", ",
-		       pos_cnt, basic->pos,
-		       neg_cnt, basic->neg,
-		       NULL, 0, table);
+    put_literal_list(style, w, ", ",
+		     pos_cnt, basic->pos,
+		     neg_cnt, basic->neg,
+		     NULL, 0, table);
   }
 
   if(style == STYLE_READABLE || style == STYLE_GNT ||
      style == STYLE_DLV)
-    fprintf(out, ".");
-  fprintf(out, "\n");
+    PUTC(w, '.');
+  PUTC(w, '\n');
 
   return;
 }
 
-void write_constraint(int style, FILE *out, RULE *rule, ATAB *table)
+void put_constraint(int style, WRITER *w, RULE *rule, ATAB *table)
 {
   int pos_cnt = 0;
   int neg_cnt = 0;
@@ -306,39 +549,52 @@ void write_constraint(int style, FILE *out, RULE *rule, ATAB *table)
   CONSTRAINT_RULE *constraint = rule->data.constraint;
 
   if(style == STYLE_SMODELS)
-    fprintf(out, "2");
+    PUTC(w, '2');
   else if(style == STYLE_ASPIF)
-    fprintf(out, "1 0 1 ");
+    PUTS(w, "1 0 1 ");
     
-  write_atom(style, out, constraint->head, table);
+  put_atom(style, w, constraint->head, table);
 
   pos_cnt = constraint->pos_cnt;
   neg_cnt = constraint->neg_cnt;
   bound = constraint->bound;
 
-  if(style == STYLE_SMODELS)
-    fprintf(out, " %i %i %i", (pos_cnt+neg_cnt), neg_cnt, bound);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, " 1 %i %i ", bound, pos_cnt+neg_cnt);
+  if(style == STYLE_SMODELS) {
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+    put_int(w, neg_cnt);
+    PUTC(w, ' ');
+    put_int(w, bound);
+  } else if(style == STYLE_ASPIF) {
+    PUTS(w, " 1 ");
+    put_int(w, bound);
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+  }
     
-  if(style == STYLE_READABLE)
-    fprintf(out, " :- %i {", bound);
+  if(style == STYLE_READABLE) {
+    PUTS(w, " :- ");
+    put_int(w, bound);
+    PUTS(w, " {");
+  }
 
   if(pos_cnt || neg_cnt)
-    write_literal_list(style, out, ", ",
-		       pos_cnt, constraint->pos,
-		       neg_cnt, constraint->neg,
-		       NULL, -1 /* Use weights = 1 */, table);
+    put_literal_list(style, w, ", ",
+		     pos_cnt, constraint->pos,
+		     neg_cnt, constraint->neg,
+		     NULL, -1 /* Use weights = 1 */, table);
 
   if(style == STYLE_READABLE)
-    fprintf(out, "}.");
+    PUTS(w, "}.");
 
-  fprintf(out, "\n");
+  PUTC(w, '\n');
 
   return;
 }
 
-void write_choice(int style, FILE *out, RULE *rule, ATAB *table)
+void put_choice(int style, WRITER *w, RULE *rule, ATAB *table)
 {
   int head_cnt = 0;
   int pos_cnt = 0;
@@ -350,49 +606,59 @@ void write_choice(int style, FILE *out, RULE *rule, ATAB *table)
   pos_cnt = choice->pos_cnt;
   neg_cnt = choice->neg_cnt;
 
-  if(style == STYLE_SMODELS)
-    fprintf(out, "3 %i", head_cnt);
-  else if(style == STYLE_READABLE)
-    fprintf(out, "{");
-  else if(style == STYLE_ASPIF)
-    fprintf(out, "1 1 %i ", head_cnt);
+  if(style == STYLE_SMODELS) {
+    PUTS(w, "3 ");
+    put_int(w, head_cnt);
+  } else if(style == STYLE_READABLE)
+    PUTC(w, '{');
+  else if(style == STYLE_ASPIF) {
+    PUTS(w, "1 1 ");
+    put_int(w, head_cnt);
+    PUTC(w, ' ');
+  }
     
   if(style == STYLE_GNT)
     separator = " | ";
   else if(style == STYLE_DLV)
     separator = " v ";
 
-  write_literal_list(style, out, separator,
-		     head_cnt, choice->head,
-		     0, NULL,
-		     NULL, 0, table);
+  put_literal_list(style, w, separator,
+		   head_cnt, choice->head,
+		   0, NULL,
+		   NULL, 0, table);
 
   if(style == STYLE_READABLE)
-    fprintf(out, "}");
-
-  if(style == STYLE_SMODELS)
-    fprintf(out, " %i %i", (pos_cnt+neg_cnt), neg_cnt);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, " 0 %i ", pos_cnt+neg_cnt);
+    PUTC(w, '}');
+
+  if(style == STYLE_SMODELS) {
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+    put_int(w, neg_cnt);
+  } else if(style == STYLE_ASPIF) {
+    PUTS(w, " 0 ");
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+  }
     
   if(pos_cnt || neg_cnt) {
     if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-      fprintf(out, " :- ");
+      PUTS(w, " :- ");
 
-    write_literal_list(style, out, ", ",
-		       pos_cnt, choice->pos,
-		       neg_cnt, choice->neg,
-		       NULL, 0, table);
+    put_literal_list(style, w, ", ",
+		     pos_cnt, choice->pos,
+		     neg_cnt, choice->neg,
+		     NULL, 0, table);
   }
 
   if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-    fprintf(out, ".");
-  fprintf(out, "\n");
+    PUTC(w, '.');
+  PUTC(w, '\n');
 
   return;
 }
 
-void write_integrity(int style, FILE *out, RULE *rule, ATAB *table)
+void put_integrity(int style, WRITER *w, RULE *rule, ATAB *table)
 {
   int *scan = NULL;
   int *last = NULL;
@@ -402,38 +668,44 @@ void write_integrity(int style, FILE *out, RULE *rule, ATAB *table)
   INTEGRITY_RULE *integrity = rule->data.integrity;
 
   if(style == STYLE_SMODELS)
-    fprintf(out, "4");
+    PUTC(w, '4');
   else if(style == STYLE_ASPIF)
-    fprintf(out, "1 0 0 ");
+    PUTS(w, "1 0 0 ");
   
   pos_cnt = integrity->pos_cnt;
   neg_cnt = integrity->neg_cnt;
 
-  if(style == STYLE_SMODELS)
-    fprintf(out, " %i %i", (pos_cnt+neg_cnt), neg_cnt);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, " 0 %i ", pos_cnt+neg_cnt);
+  if(style == STYLE_SMODELS) {
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+    put_int(w, neg_cnt);
+  } else if(style == STYLE_ASPIF) {
+    PUTS(w, " 0 ");
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+  }
     
   if(pos_cnt || neg_cnt) {
     if(style == STYLE_READABLE || style == STYLE_GNT ||
        style == STYLE_DLV)
-      fprintf(out, " :- ");
+      PUTS(w, " :- ");
 
-    write_literal_list(style, out, ", ",
-		       pos_cnt, integrity->pos,
-		       neg_cnt, integrity->neg,
-		       NULL, 0, table);
+    put_literal_list(style, w, ", ",
+		     pos_cnt, integrity->pos,
+		     neg_cnt, integrity->neg,
+		     NULL, 0, table);
   }
 
   if(style == STYLE_READABLE || style == STYLE_GNT ||
      style == STYLE_DLV)
-    fprintf(out, ".");
-  fprintf(out, "\n");
+    PUTC(w, '.');
+  PUTC(w, '\n');
 
   return;
 }
 
-void write_weight(int style, FILE *out, RULE *rule, ATAB *table)
+void put_weight(int style, WRITER *w, RULE *rule, ATAB *table)
 {
   int pos_cnt = 0;
   int neg_cnt = 0;
@@ -442,38 +714,51 @@ void write_weight(int style, FILE *out, RULE *rule, ATAB *table)
   WEIGHT_RULE *weight = rule->data.weight;
 
   if(style == STYLE_SMODELS)
-    fprintf(out, "5");
+    PUTC(w, '5');
   else if(style == STYLE_ASPIF)
-    fprintf(out, "1 0 1 ");
+    PUTS(w, "1 0 1 ");
     
-  write_atom(style, out, weight->head, table);
+  put_atom(style, w, weight->head, table);
 
   pos_cnt = weight->pos_cnt;
   neg_cnt = weight->neg_cnt;
   bound = weight->bound;
 
-  if(style == STYLE_SMODELS)
-    fprintf(out, " %i %i %i", bound, (pos_cnt+neg_cnt), neg_cnt);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, " 1 %i %i ", bound, pos_cnt+neg_cnt);
+  if(style == STYLE_SMODELS) {
+    PUTC(w, ' ');
+    put_int(w, bound);
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+    put_int(w, neg_cnt);
+  } else if(style == STYLE_ASPIF) {
+    PUTS(w, " 1 ");
+    put_int(w, bound);
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+  }
     
-  if(style == STYLE_READABLE)
-    fprintf(out, " :- %i [", bound);
+  if(style == STYLE_READABLE) {
+    PUTS(w, " :- ");
+    put_int(w, bound);
+    PUTS(w, " [");
+  }
 
   if(pos_cnt || neg_cnt)
-    write_literal_list(style, out, ", ",
-		       pos_cnt, weight->pos,
-		       neg_cnt, weight->neg,
-		       weight->weight, 0, table);
+    put_literal_list(style, w, ", ",
+		     pos_cnt, weight->pos,
+		     neg_cnt, weight->neg,
+		     weight->weight, 0, table);
 
   if(style == STYLE_READABLE)
-    fprintf(out, "].");
-  fprintf(out, "\n");
+    PUTS(w, "].");
+  PUTC(w, '\n');
 
   return;
 }
 
-void write_optimize(int style, FILE *out, RULE *rule, ATAB *table)
+void put_optimize(int style, WRITER *w, RULE *rule, ATAB *table)
 {
   int pos_cnt = 0;
   int neg_cnt = 0;
@@ -481,36 +766,44 @@ void write_optimize(int style, FILE *out, RULE *rule, ATAB *table)
   OPTIMIZE_RULE *optimize = rule->data.optimize;
 
   if(style == STYLE_SMODELS)
-    fprintf(out, "6 0");
-  else if(style == STYLE_ASPIF)
-    fprintf(out, "2 %i", priority++);
+    PUTS(w, "6 0");
+  else if(style == STYLE_ASPIF) {
+    PUTS(w, "2 ");
+    put_int(w, (*(w->priority))++);
+  }
     
   pos_cnt = optimize->pos_cnt;
   neg_cnt = optimize->neg_cnt;
 
-  if(style == STYLE_SMODELS)
-    fprintf(out, " %i %i", (pos_cnt+neg_cnt), neg_cnt);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, " %i ", pos_cnt+neg_cnt);
+  if(style == STYLE_SMODELS) {
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+    put_int(w, neg_cnt);
+  } else if(style == STYLE_ASPIF) {
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+  }
     
   if(pos_cnt || neg_cnt) {
     if(style == STYLE_READABLE)
-      fprintf(out, "minimize [");
+      PUTS(w, "minimize [");
 
-    write_literal_list(style, out, ", ",
-		       pos_cnt, optimize->pos,
-		       neg_cnt, optimize->neg,
-		       optimize->weight, 0, table);
+    put_literal_list(style, w, ", ",
+		     pos_cnt, optimize->pos,
+		     neg_cnt, optimize->neg,
+		     optimize->weight, 0, table);
 
     if(style == STYLE_READABLE)
-      fprintf(out, "].");
+      PUTS(w, "].");
   }
-  fprintf(out, "\n");
+  PUTC(w, '\n');
 
   return;
 }
 
-void write_disjunctive(int style, FILE *out, RULE *rule, ATAB *table)
+void put_disjunctive(int style, WRITER *w, RULE *rule, ATAB *table)
 {
   int head_cnt = 0;
   int pos_cnt = 0;
@@ -522,37 +815,47 @@ void write_disjunctive(int style, FILE *out, RULE *rule, ATAB *table)
   pos_cnt = disjunctive->pos_cnt;
   neg_cnt = disjunctive->neg_cnt;
 
-  if(style == STYLE_SMODELS)
-    fprintf(out, "8 %i", head_cnt);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, "1 0 %i ", head_cnt);
+  if(style == STYLE_SMODELS) {
+    PUTS(w, "8 ");
+    put_int(w, head_cnt);
+  } else if(style == STYLE_ASPIF) {
+    PUTS(w, "1 0 ");
+    put_int(w, head_cnt);
+    PUTC(w, ' ');
+  }
     
   if(style == STYLE_DLV)
     separator = " v ";
 
-  write_literal_list(style, out, separator,
-		     head_cnt, disjunctive->head,
-		     0, NULL,
-		     NULL, 0, table);
-
-  if(style == STYLE_SMODELS)
-    fprintf(out, " %i %i", (pos_cnt+neg_cnt), neg_cnt);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, " 0 %i ", pos_cnt+neg_cnt);
+  put_literal_list(style, w, separator,
+		   head_cnt, disjunctive->head,
+		   0, NULL,
+		   NULL, 0, table);
+
+  if(style == STYLE_SMODELS) {
+    PUTC(w, ' ');
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+    put_int(w, neg_cnt);
+  } else if(style == STYLE_ASPIF) {
+    PUTS(w, " 0 ");
+    put_int(w, pos_cnt+neg_cnt);
+    PUTC(w, ' ');
+  }
     
   if(pos_cnt || neg_cnt) {
     if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-      fprintf(out, " :- ");
+      PUTS(w, " :- ");
 
-    write_literal_list(style, out, ", ",
-		       pos_cnt, disjunctive->pos,
-		       neg_cnt, disjunctive->neg,
-		       NULL, 0, table);
+    put_literal_list(style, w, ", ",
+		     pos_cnt, disjunctive->pos,
+		     neg_cnt, disjunctive->neg,
+		     NULL, 0, table);
   }
 
   if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-    fprintf(out, ".");
-  fprintf(out, "\n");
+    PUTC(w, '.');
+  PUTC(w, '\n');
 
   return;
 }
@@ -563,176 +866,213 @@ void write_clause_as_rule(int style, FILE *out, RULE *rule, ATAB *table1,
   int pos_cnt = 0;
   int neg_cnt = 0;
   CLAUSE *clause = rule->data.clause;
+  WRITER w;
 
   /* NOTE: the roles of positive/negative literals are interchanged:
    *       a clause 'a | -b' is expressed as a rule ":- b, not a". */
 
+  open_writer(&w, out);
+
   if(style == STYLE_SMODELS)
-    fprintf(out, "1");
+    PUTC(&w, '1');
   else if(style == STYLE_ASPIF)
-    fprintf(out, "1 0 1 ");
+    PUTS(&w, "1 0 1 ");
     
-  write_atom(style, out, contradiction, table2);
+  put_atom(style, &w, contradiction, table2);
 
   pos_cnt = clause->pos_cnt;
   neg_cnt = clause->neg_cnt;
 
-  if(style == STYLE_SMODELS)
-    fprintf(out, " %i %i", (pos_cnt+neg_cnt), pos_cnt);
-  else if(style == STYLE_ASPIF)
-    fprintf(out, " 0 %i ", pos_cnt+neg_cnt);
+  if(style == STYLE_SMODELS) {
+    PUTC(&w, ' ');
+    put_int(&w, pos_cnt+neg_cnt);
+    PUTC(&w, ' ');
+    put_int(&w, pos_cnt);
+  } else if(style == STYLE_ASPIF) {
+    PUTS(&w, " 0 ");
+    put_int(&w, pos_cnt+neg_cnt);
+    PUTC(&w, ' ');
+  }
     
   if(pos_cnt || neg_cnt) {
     if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-      fprintf(out, " :- ");
+      PUTS(&w, " :- ");
 
-    write_literal_list(style, out, ", ",
-		       neg_cnt, clause->neg,
-		       pos_cnt, clause->pos,
-		       NULL, 0, table1);
+    put_literal_list(style, &w, ", ",
+		     neg_cnt, clause->neg,
+		     pos_cnt, clause->pos,
+		     NULL, 0, table1);
       
   }
   if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-    fprintf(out, ".");
-  fprintf(out, "\n");
+    PUTC(&w, '.');
+  PUTC(&w, '\n');
 
+  flush_writer(&w);
 }
 
-void write_rule(int style, FILE *out, RULE *rule, ATAB *table)
+void put_rule(int style, WRITER *w, RULE *rule, ATAB *table)
 {
   switch(rule->type) {
   case TYPE_BASIC:
-    write_basic(style, out, rule, table);
+    put_basic(style, w, rule, table);
     break;
 
   case TYPE_CONSTRAINT:
     if(style == STYLE_GNT || style == STYLE_DLV) {
-      fprintf(stderr,
-	      "%s: constraint rules are not supported by gnt nor dlv!\n",
-              program_name);
-      exit(-1);
+      abort_writer(w);
+      failure(ERROR_UNSUPPORTED,
+	      "constraint rules are not supported by gnt nor dlv!");
     }
-    write_constraint(style, out, rule, table);
+    put_constraint(style, w, rule, table);
     break;
 
   case TYPE_CHOICE:
-    write_choice(style, out, rule, table);
+    put_choice(style, w, rule, table);
     break;
 
   case TYPE_INTEGRITY:
-    write_integrity(style, out, rule, table);
+    put_integrity(style, w, rule, table);
     break;
 
   case TYPE_WEIGHT:
     if(style == STYLE_GNT || style == STYLE_DLV) {
-      fprintf(stderr,
-	      "%s: weight rules are not supported by gnt nor dlv!\n",
-              program_name);
-      exit(-1);
+      abort_writer(w);
+      failure(ERROR_UNSUPPORTED,
+	      "weight rules are not supported by gnt nor dlv!");
     }
-    write_weight(style, out, rule, table);
+    put_weight(style, w, rule, table);
     break;
 
   case TYPE_OPTIMIZE:
     if(style == STYLE_GNT || style == STYLE_DLV) {
-      fprintf(stderr,
-	      "%s: optimize statements are not supported by gnt nor dlv!\n",
-              program_name);
-      exit(-1);
+      abort_writer(w);
+      failure(ERROR_UNSUPPORTED,
+	      "optimize statements are not supported by gnt nor dlv!");
     }
-    write_optimize(style, out, rule, table);
+    put_optimize(style, w, rule, table);
     break;
 
   case TYPE_DISJUNCTIVE:
-    write_disjunctive(style, out, rule, table);
+    put_disjunctive(style, w, rule, table);
     break;
 
   default:
-    error("unknown rule type");
+    abort_writer(w);
+    failure(ERROR_UNSUPPORTED, "unknown rule type");
   }
 }
 
-void write_program(int style, FILE *out, RULE *rule, ATAB *table)
+void write_rule(int style, FILE *out, RULE *rule, ATAB *table)
 {
-  while(rule) {
-    write_rule(style, out, rule, table);
-    rule = rule->next;
-  }
+  WRITER w;
+
+  open_writer(&w, out);
+  put_rule(style, &w, rule, table);
+  flush_writer(&w);
+
   return;
 }
 
-void write_status(FILE *out, int flags)
+void put_status(WRITER *w, int flags)
 {
   if(flags & MARK_TRUE)
-    fprintf(out, "T");
+    PUTC(w, 'T');
   if(flags & MARK_FALSE)
-    fprintf(out, "F");
+    PUTC(w, 'F');
   if(flags & MARK_HEADOCC)
-    fprintf(out, "H");
+    PUTC(w, 'H');
   if(flags & MARK_POSOCC)
-    fprintf(out, "P");
+    PUTC(w, 'P');
   if(flags & MARK_NEGOCC)
-    fprintf(out, "N");
+    PUTC(w, 'N');
   if(flags & MARK_VISIBLE)
-    fprintf(out, "V");
+    PUTC(w, 'V');
   if(flags & MARK_INPUT)
-    fprintf(out, "I");
+    PUTC(w, 'I');
+
+  return;
+}
+
+void write_status(FILE *out, int flags)
+{
+  WRITER w;
+
+  open_writer(&w, out);
+  put_status(&w, flags);
+  flush_writer(&w);
 
   return;
 }
 
 void write_symbols(int style, FILE *out, ATAB *table)
 {
+  WRITER w;
+
+  open_writer(&w, out);
   while(table) {
     int count = table->count;
     int offset = table->offset;
     int shift = table->shift;
     SYMBOL **names = table->names;
-    int *statuses = table->statuses;
     int i = 0;
 
     for(i=1; i<=count; i++) {
       int atom = i+offset;
       SYMBOL *name = names[i];
+      int status = get_piece_status(table, i);
       
       switch(style) {
       case STYLE_READABLE:
       case STYLE_GNT:
       case STYLE_DLV:
-	fprintf(out, "%% _%i = ", atom+shift);
-	write_atom(style, out, atom, table);
-	if(statuses[i]) {
-	  fprintf(out, ": ");
-	  write_status(out, statuses[i]);
+	PUTS(&w, "% _");
+	put_int(&w, atom+shift);
+	PUTS(&w, " = ");
+	put_atom(style, &w, atom, table);
+	if(status) {
+	  PUTS(&w, ": ");
+	  put_status(&w, status);
 	}
-	fprintf(out, "\n");
+	PUTC(&w, '\n');
 	break;
 
       case STYLE_SMODELS:
 	/* Only atoms having a symbolic name are printed */
 
 	if(name) {
-	  fprintf(out, "%i ", atom+shift);
-	  write_atom(STYLE_READABLE, out, atom, table);
-	  fprintf(out, "\n");
+	  put_int(&w, atom+shift);
+	  PUTC(&w, ' ');
+	  put_atom(STYLE_READABLE, &w, atom, table);
+	  PUTC(&w, '\n');
 	}
 	break;
 	
       case STYLE_ASPIF:
 	/* Only atoms having a symbolic name are printed */
 
-	if(name)
-	  fprintf(out, "4 %i %s 1 %i\n",
-		  (int)strlen(name->name), name->name, atom+shift);
+	if(name) {
+	  size_t len = strlen(name->name);
+
+	  PUTS(&w, "4 ");
+	  put_int(&w, (int)len);
+	  PUTC(&w, ' ');
+	  put_block(&w, name->name, len);
+	  PUTS(&w, " 1 ");
+	  put_int(&w, atom+shift);
+	  PUTC(&w, '\n');
+	}
 	break;
 
       case STYLE_DIMACS:
 	/* Only atoms having a symbolic name are printed in comments */
 	
 	if(name) {
-	  fprintf(out, "c %i ", atom+shift);
-	  write_atom(style, out, atom, table);
-	  fprintf(out, "\n");
+	  PUTS(&w, "c ");
+	  put_int(&w, atom+shift);
+	  PUTC(&w, ' ');
+	  put_atom(style, &w, atom, table);
+	  PUTC(&w, '\n');
 	}
 	break;
       default:
@@ -741,80 +1081,94 @@ void write_symbols(int style, FILE *out, ATAB *table)
     }
     table = table->next;
   }
+  flush_writer(&w);
+
   return;
 }
 
 void write_compute_statement(int style, FILE *out, ATAB *table, int mask)
 {
   int first = -1;
-  
+  WRITER w;
+
+  open_writer(&w, out);
   while(table) {
     int count = table->count;
     int offset = table->offset;
     int shift = table->shift;
-    int *statuses = table->statuses;
     int i = 0;
 
-    for(i=1; i<=count; i++) {
+    for(i=next_status(table, 1, mask); i<=count;
+	i=next_status(table, i+1, mask)) {
       int atom = i+offset;
-      int status = statuses[i];
+      int status = get_piece_status(table, i);
 
       if(status & mask)
 	switch(style) {
 	case STYLE_READABLE:
 	case STYLE_GNT:
 	  if((mask & MARK_TRUE) & status) {
-	    if(first) first = 0; else fprintf(out, ", ");
-	    write_atom(style, out, atom, table);
+	    if(first) first = 0; else PUTS(&w, ", ");
+	    put_atom(style, &w, atom, table);
 	  }
 	  if((mask & MARK_FALSE) & status) {
-	    if(first) first = 0; else fprintf(out, ", ");
-	    fprintf(out, "not ");
-	    write_atom(style, out, atom, table);
+	    if(first) first = 0; else PUTS(&w, ", ");
+	    PUTS(&w, "not ");
+	    put_atom(style, &w, atom, table);
 	  }
 	  if((mask & MARK_INPUT) & status) {
 	    if(style == STYLE_READABLE) {
-	      if(first) first = 0; else fprintf(out, ", ");
-	      write_atom(style, out, atom, table);
+	      if(first) first = 0; else PUTS(&w, ", ");
+	      put_atom(style, &w, atom, table);
 	    } else {
-	      fprintf(out, "{");
-	      write_atom(style, out, atom, table);
-	      fprintf(out, ",");
-	      write_atom(style, out, atom, table);
-	      fprintf(out, "'}.\n");
+	      PUTC(&w, '{');
+	      put_atom(style, &w, atom, table);
+	      PUTC(&w, ',');
+	      put_atom(style, &w, atom, table);
+	      PUTS(&w, "'}.\n");
 	    }
 	  }
 	  break;
 
 	case STYLE_SMODELS:
-	  fprintf(out, "%i\n", atom+shift);
+	  put_int(&w, atom+shift);
+	  PUTC(&w, '\n');
 	  break;
 
 	case STYLE_ASPIF:
-	  if((mask & MARK_TRUE) & status)
-	    fprintf(out, "6 1 %i\n", atom+shift);
-	  if((mask & MARK_FALSE) & status)
-	    fprintf(out, "6 1 -%i\n", atom+shift);
-	  if((mask & MARK_INPUT) & status)
-	    fprintf(out, "5 %i 0\n", atom+shift);
+	  if((mask & MARK_TRUE) & status) {
+	    PUTS(&w, "6 1 ");
+	    put_int(&w, atom+shift);
+	    PUTC(&w, '\n');
+	  }
+	  if((mask & MARK_FALSE) & status) {
+	    PUTS(&w, "6 1 -");
+	    put_int(&w, atom+shift);
+	    PUTC(&w, '\n');
+	  }
+	  if((mask & MARK_INPUT) & status) {
+	    PUTS(&w, "5 ");
+	    put_int(&w, atom+shift);
+	    PUTS(&w, " 0\n");
+	  }
 	  break;
 	  
 	case STYLE_DLV:
 	  if((mask & MARK_TRUE) & status) {
-	    fprintf(out, ":- not ");
-	    write_atom(style, out, atom, table);
-	    fprintf(out, ".\n");
+	    PUTS(&w, ":- not ");
+	    put_atom(style, &w, atom, table);
+	    PUTS(&w, ".\n");
 	  }
 	  if((mask & MARK_FALSE) & status) {
-	    fprintf(out, ":- ");
-	    write_atom(style, out, atom, table);
-	    fprintf(out, ".\n");
+	    PUTS(&w, ":- ");
+	    put_atom(style, &w, atom, table);
+	    PUTS(&w, ".\n");
 	  }
 	  if((mask & MARK_INPUT) & status) {
-	    write_atom(style, out, atom, table);
-	    fprintf(out, " v int");
-	    write_atom(style, out, atom, table);
-	    fprintf(out, ".\n");
+	    put_atom(style, &w, atom, table);
+	    PUTS(&w, " v int");
+	    put_atom(style, &w, atom, table);
+	    PUTS(&w, ".\n");
 	  }
 	  break;
 
@@ -822,39 +1176,29 @@ void write_compute_statement(int style, FILE *out, ATAB *table, int mask)
     }
     table = table->next;
   }
+  flush_writer(&w);
+
   return;
 }
 
 void write_input(int style, FILE *out, ATAB *table)
 {
   ATAB *scan = table;
-  int head_count = 0;
-  int i = 0;
-
-  /* Count head atoms */
-
-  while(scan) {
-    int count = scan->count;
-    int offset = scan->offset;
-    int shift = scan->shift;
-    SYMBOL **names = scan->names;
-    int *statuses = scan->statuses;
-
-    for(i=1; i<=count; i++) 
-      if(names[i] && (statuses[i] & MARK_INPUT))
-	head_count++;
-
-    scan = scan->next;
-  }
+  int head_count = count_statuses(table, MARK_INPUT, -1);
+  WRITER w;
 
   if(head_count) {
 
-    if(style == STYLE_SMODELS)
-      fprintf(out, "3 %i", head_count);
-    else if(style == STYLE_ASPIF)
-      fprintf(out, "1 1 %i", head_count);
-    else
-      fprintf(out, "{ ");
+    open_writer(&w, out);
+
+    if(style == STYLE_SMODELS) {
+      PUTS(&w, "3 ");
+      put_int(&w, head_count);
+    } else if(style == STYLE_ASPIF) {
+      PUTS(&w, "1 1 ");
+      put_int(&w, head_count);
+    } else
+      PUTS(&w, "{ ");
 
     scan = table;
 
@@ -863,18 +1207,18 @@ void write_input(int style, FILE *out, ATAB *table)
       int offset = scan->offset;
       int shift = scan->shift;
       SYMBOL **names = scan->names;
-      int *statuses = scan->statuses;
       int i = 0;
 
-      for(i=1; i<=count; i++) {
+      for(i=next_status(scan, 1, MARK_INPUT); i<=count;
+	  i=next_status(scan, i+1, MARK_INPUT)) {
 	int atom = i+offset;
 
-	if(names[i] && (statuses[i] & MARK_INPUT)) {
+	if(names[i]) {
 	  if(style == STYLE_ASPIF)
-	    fputs(" ", out);
-	  write_atom(style, out, atom, table);
+	    PUTC(&w, ' ');
+	  put_atom(style, &w, atom, table);
 	  if(style == STYLE_READABLE && (--head_count))
-	    fprintf(out, ", ");
+	    PUTS(&w, ", ");
 	}
       }
 
@@ -882,9 +1226,11 @@ void write_input(int style, FILE *out, ATAB *table)
     }
 
     if(style == STYLE_READABLE)
-      fprintf(out, " }.\n");
+      PUTS(&w, " }.\n");
     else if(style == STYLE_SMODELS || style == STYLE_ASPIF)
-      fprintf(out, " 0 0\n");
+      PUTS(&w, " 0 0\n");
+
+    flush_writer(&w);
   }
 
   return;
@@ -893,7 +1239,7 @@ void write_input(int style, FILE *out, ATAB *table)
 
 /* ------------------ Support for DIMACS cnf/wcnf format ------------------- */
 
-void write_classical_atom(int style, FILE *out, int atom, ATAB *table)
+void put_classical_atom(int style, WRITER *w, int atom, ATAB *table)
 {
   ATAB *piece = find_atom(table, atom);
 
@@ -909,28 +1255,40 @@ void write_classical_atom(int style, FILE *out, int atom, ATAB *table)
     case STYLE_DLV:
 
       if(name)
-	write_name(out, name, piece->prefix, piece->postfix);
-      else
-	fprintf(out, "_%i", atom+shift);
+	put_atom_name(w, name, piece);
+      else {
+	PUTC(w, '_');
+	put_int(w, atom+shift);
+      }
       break;
 
     case STYLE_DIMACS:
-      fprintf(out, "%i", atom+shift);
+      put_int(w, atom+shift);
       break;
 
     default:
-      fprintf(stderr, "%s: unknown style %i for _%i\n",
-	      program_name, style, atom);
-      exit(-1);
+      abort_writer(w);
+      failure(ERROR_UNSUPPORTED, "unknown style %i for _%i", style, atom);
     }
   } else {
-    fprintf(stderr, "%s: entry #%i out of table\n", program_name, atom);
-    exit(-1);
+    abort_writer(w);
+    failure(ERROR_TABLE, "entry #%i out of table", atom);
   }
 
   return;
 }
 
+void write_classical_atom(int style, FILE *out, int atom, ATAB *table)
+{
+  WRITER w;
+
+  open_writer(&w, out);
+  put_classical_atom(style, &w, atom, table);
+  flush_writer(&w);
+
+  return;
+}
+
 void write_other_classical_atom(int style, FILE *out, int atom, ATAB *table)
 {
   ATAB *piece = find_atom(table, atom);
@@ -941,57 +1299,55 @@ void write_other_classical_atom(int style, FILE *out, int atom, ATAB *table)
     int *others = piece->others;
 
     if(!other || !others || !others[atom-offset]) {
-      fprintf(stderr, "%s: missing cross reference for ", program_name);
-      write_classical_atom(style, stderr, atom, table);
-      fprintf(stderr, "\n");
-      exit(-1);
+      char name[ERROR_SIZE];
+
+      atom_text(name, put_classical_atom, style, atom, table);
+      failure(ERROR_TABLE, "missing cross reference for %s", name);
     } else
       write_classical_atom(style, out, others[atom-offset], other);
 
-  } else {
-    fprintf(stderr, "%s: entry #%i out of table\n", program_name, atom);
-    exit(-1);
-  }
+  } else
+    failure(ERROR_TABLE, "entry #%i out of table", atom);
 
   return;
 }
 
 
-void write_classical_literal_list(int style, FILE *out,
-				  int pos_cnt, int *pos,
-				  int neg_cnt, int *neg,
-				  ATAB *table)
+void put_classical_literal_list(int style, WRITER *w,
+				int pos_cnt, int *pos,
+				int neg_cnt, int *neg,
+				ATAB *table)
 {
   int *scan = NULL;
   int *last = NULL;
 
   for(scan = neg, last = &neg[neg_cnt];
       scan != last; ) {
-    fprintf(out, "-");
-    write_classical_atom(style, out, *scan, table);
+    PUTC(w, '-');
+    put_classical_atom(style, w, *scan, table);
     scan++;
     if(scan != last || pos_cnt) {
       if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-	fputs(" |", out);
-      fputs(" ", out);
+	PUTS(w, " |");
+      PUTC(w, ' ');
     }
   }
 
   for(scan = pos, last = &pos[pos_cnt];
       scan != last; ) {
-    write_classical_atom(style, out, *scan, table);
+    put_classical_atom(style, w, *scan, table);
     scan++;
     if(scan != last) {
       if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-	fputs(" |", out);
-      fputs(" ", out);
+	PUTS(w, " |");
+      PUTC(w, ' ');
     }
   }
 
   return;
 }
 
-void write_clause(int style, FILE *out, RULE *cnf, ATAB *table)
+void put_clause(int style, WRITER *w, RULE *cnf, ATAB *table)
 {
   int type = cnf->type;
   CLAUSE *clause = cnf->data.clause;
@@ -1000,39 +1356,365 @@ void write_clause(int style, FILE *out, RULE *cnf, ATAB *table)
   long weight = clause->weight;
 
   if(type != TYPE_CLAUSE) {
-    fprintf(stderr, "%s: only clauses are supported by cnf routines!\n",
-	    program_name);
-    exit(-1);
+    abort_writer(w);
+    failure(ERROR_UNSUPPORTED, "only clauses are supported by cnf routines!");
   }
 
-  if(weight && style == STYLE_DIMACS)
-    fprintf(out, "%li ", weight);
+  if(weight && style == STYLE_DIMACS) {
+    put_long(w, weight);
+    PUTC(w, ' ');
+  }
 
-  write_classical_literal_list(style, out,
-			       pos_cnt, clause->pos,
-			       neg_cnt, clause->neg,
-			       table);
+  put_classical_literal_list(style, w,
+			     pos_cnt, clause->pos,
+			     neg_cnt, clause->neg,
+			     table);
 
-  if(weight && style == STYLE_READABLE)
-    fprintf(out, " = %li", weight);
+  if(weight && style == STYLE_READABLE) {
+    PUTS(w, " = ");
+    put_long(w, weight);
+  }
 
   if(style == STYLE_READABLE || style == STYLE_GNT || style == STYLE_DLV)
-    fprintf(out, ".\n");
+    PUTS(w, ".\n");
   else if(style == STYLE_DIMACS)
-    fprintf(out, " 0\n");
+    PUTS(w, " 0\n");
+
+  return;
+}
+
+/* ---------------- Output of programs and sets of clauses ----------------- */
+
+/* With several threads, rules are formatted in chunks in memory by the
+   workers; the chunks of a round are then written in order.  Priorities
+   of optimize statements are assigned in advance for each chunk. */
+
+#define WRITE_CHUNK (1<<14)  /* Rules per chunk */
+
+typedef struct wchunk {
+  RULE *first;        /* First rule (for lists) */
+  long start;         /* Index of the first rule (for tables) */
+  int count;          /* Number of rules */
+  int priority;       /* Priority of the first optimize statement */
+  int next_priority;  /* Counter used when formatting */
+  int failed;         /* An error occurred */
+  WRITER w;           /* Formatted output */
+} WCHUNK;
+
+typedef struct wchunks {
+  int style;
+  int clauses;        /* Clauses rather than rules */
+  RTAB *rules;        /* Table of rules (NULL for a list) */
+  ATAB *table;
+  WCHUNK *chunk;
+} WCHUNKS;
+
+void put_chunk(WCHUNKS *chunks, WCHUNK *chunk, WRITER *w)
+{
+  RULE *rule = chunk->first;
+  int i = 0;
+
+  for(i=0; i<chunk->count; i++) {
+    RULE view;
+    RULE_DATA data;
+
+    if(chunks->rules)
+      rule = view_rule(chunks->rules, chunk->start+i, &view, &data);
+    if(chunks->clauses)
+      put_clause(chunks->style, w, rule, chunks->table);
+    else
+      put_rule(chunks->style, w, rule, chunks->table);
+    if(!chunks->rules)
+      rule = rule->next;
+  }
+
+  return;
+}
+
+void format_chunk(void *data, int index)
+{
+  WCHUNKS *chunks = (WCHUNKS *)data;
+  WCHUNK *chunk = &(chunks->chunk)[index];
+  jmp_buf abort;
+
+  chunk->w.pos = chunk->w.buf;
+  chunk->next_priority = chunk->priority;
+  chunk->w.priority = &chunk->next_priority;
+  chunk->failed = 0;
+
+  if(setjmp(abort)) {
+    chunk->failed = -1;
+    return;
+  }
+  chunk->w.abort = &abort;
+  put_chunk(chunks, chunk, &chunk->w);
+  chunk->w.abort = NULL;
+
+  return;
+}
+
+/* Reproduce the output and the failure of a chunk sequentially; the
+   failure is caught so that the chunks can be released (see below) */
+
+int rewrite_chunk(WCHUNKS *chunks, WCHUNK *chunk, FILE *out)
+{
+  int saved = current_context->priority;
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int failed = 0;
+  WRITER w;
+
+  if(setjmp(abort) == 0) {
+    open_writer(&w, out);
+    current_context->priority = chunk->priority;
+    put_chunk(chunks, chunk, &w);
+    flush_writer(&w);
+  } else
+    failed = -1;
+
+  current_context->priority = saved;
+  (void) catch_errors(previous);
+
+  return failed;
+}
+
+void write_parallel(int style, FILE *out, RULE *rule, RTAB *rules,
+		    int clauses, ATAB *table)
+{
+  int jobs = 4*worker_threads;
+  WCHUNK *chunk = (WCHUNK *)malloc(jobs * sizeof(WCHUNK));
+  WCHUNKS chunks;
+  long next = 0;
+  int i = 0;
+
+  if(!chunk)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  chunks.style = style;
+  chunks.clauses = clauses;
+  chunks.rules = rules;
+  chunks.table = table;
+  chunks.chunk = chunk;
+
+  for(i=0; i<jobs; i++)
+    open_writer(&chunk[i].w, NULL);
+
+  index_table(table);  /* Shared by the workers */
+
+  while(rules ? next < rules->count : rule != NULL) {
+    int cnt = 0;
+
+    /* Form a round of chunks */
+
+    for(cnt=0; cnt<jobs && (rules ? next < rules->count : rule != NULL);
+	cnt++) {
+      WCHUNK *current = &chunk[cnt];
+
+      current->first = rule;
+      current->start = next;
+      current->count = 0;
+      current->priority = current_context->priority;
+
+      while(current->count < WRITE_CHUNK &&
+	    (rules ? next < rules->count : rule != NULL)) {
+	int type = rules ? (rules->types)[next] : rule->type;
+
+	if(type == TYPE_OPTIMIZE && style == STYLE_ASPIF)
+	  (current_context->priority)++;
+	current->count++;
+	next++;
+	if(!rules)
+	  rule = rule->next;
+      }
+    }
+
+    run_parallel(cnt, format_chunk, &chunks);
+
+    for(i=0; i<cnt; i++) {
+      WCHUNK *current = &chunk[i];
+
+      if(current->failed) {
+	if(rewrite_chunk(&chunks, current, out)) {
+	  for(i=0; i<jobs; i++)
+	    close_writer(&chunk[i].w);
+	  free(chunk);
+	  raise_failure();
+	}
+      } else
+	fwrite(current->w.buf, 1, current->w.pos - current->w.buf, out);
+    }
+  }
+
+  for(i=0; i<jobs; i++)
+    close_writer(&chunk[i].w);
+  free(chunk);
+
+  return;
+}
+
+void write_program(int style, FILE *out, RULE *rule, ATAB *table)
+{
+  WRITER w;
+
+  if(worker_threads > 1) {
+    write_parallel(style, out, rule, NULL, 0, table);
+    return;
+  }
+
+  open_writer(&w, out);
+  while(rule) {
+    put_rule(style, &w, rule, table);
+    rule = rule->next;
+  }
+  flush_writer(&w);
+
+  return;
+}
+
+void write_program_rtab(int style, FILE *out, RTAB *rules, ATAB *table)
+{
+  WRITER w;
+  long i = 0;
+
+  if(worker_threads > 1) {
+    write_parallel(style, out, NULL, rules, 0, table);
+    return;
+  }
+
+  open_writer(&w, out);
+  for(i=0; i<rules->count; i++) {
+    RULE view;
+    RULE_DATA data;
+
+    put_rule(style, &w, view_rule(rules, i, &view, &data), table);
+  }
+  flush_writer(&w);
 
   return;
 }
 
 void write_cnf(int style, FILE *out, RULE *cnf, ATAB *table)
 {
+  WRITER w;
+
+  if(worker_threads > 1) {
+    write_parallel(style, out, cnf, NULL, -1, table);
+    return;
+  }
+
+  open_writer(&w, out);
   while(cnf) {
-    write_clause(style, out, cnf, table);
+    put_clause(style, &w, cnf, table);
     cnf = cnf->next;
   }
+  flush_writer(&w);
+
   return;
 }
 
+void write_cnf_rtab(int style, FILE *out, RTAB *cnf, ATAB *table)
+{
+  WRITER w;
+  long i = 0;
+
+  if(worker_threads > 1) {
+    write_parallel(style, out, NULL, cnf, -1, table);
+    return;
+  }
+
+  open_writer(&w, out);
+  for(i=0; i<cnf->count; i++) {
+    RULE view;
+    RULE_DATA data;
+
+    put_clause(style, &w, view_rule(cnf, i, &view, &data), table);
+  }
+  flush_writer(&w);
+
+  return;
+}
+
+/* As write_program but ASPIF priorities are taken from the given context
+   rather than from the current one (see context.h) */
+
+void write_program_ctx(CONTEXT *context, int style, FILE *out,
+		       RULE *program, ATAB *table)
+{
+  CONTEXT *previous = use_context(context);
+
+  write_program(style, out, program, table);
+  (void) use_context(previous);
+
+  return;
+}
+
+/* -------------------------- Writing with a status ----------------------- */
+
+/* As above but the code of a failure (see context.h) or ERROR_NONE is
+   returned instead of exiting; the output may be incomplete on failures
+   and the message is found in the current context */
+
+int write_program_status(int style, FILE *out, RULE *program, ATAB *table)
+{
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  if(setjmp(abort) == 0)
+    write_program(style, out, program, table);
+  else
+    code = current_context->error;
+  (void) catch_errors(previous);
+
+  return code;
+}
+
+int write_symbols_status(int style, FILE *out, ATAB *table)
+{
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  if(setjmp(abort) == 0)
+    write_symbols(style, out, table);
+  else
+    code = current_context->error;
+  (void) catch_errors(previous);
+
+  return code;
+}
+
+int write_compute_statement_status(int style, FILE *out, ATAB *table,
+				   int mask)
+{
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  if(setjmp(abort) == 0)
+    write_compute_statement(style, out, table, mask);
+  else
+    code = current_context->error;
+  (void) catch_errors(previous);
+
+  return code;
+}
+
+int write_cnf_status(int style, FILE *out, RULE *cnf, ATAB *table)
+{
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  if(setjmp(abort) == 0)
+    write_cnf(style, out, cnf, table);
+  else
+    code = current_context->error;
+  (void) catch_errors(previous);
+
+  return code;
+}
+
 /* ------------------ Free the memory taken by a program ------------------ */
 
 /* See input.c for to understand how memory was allocated */
@@ -1097,10 +1779,10 @@ void free_disjunctive(DISJUNCTIVE_RULE *disjunctive)
 
 void free_clause(CLAUSE *clause)
 {
+  /* Negative and positive literals share a table (see input.c) */
+
   if(clause->neg)
     free(clause->neg);
-  if(clause->pos)
-    free(clause->pos);
   free(clause);
 
   return;
@@ -1108,6 +1790,9 @@ void free_clause(CLAUSE *clause)
 
 void free_rule(RULE *rule)
 {
+  if(rule->arena == RULE_IN_ARENA)
+    return;  /* Released with the arena (see free_rule_arena) */
+
   switch(rule->type) {
   case TYPE_BASIC:
     free_basic(rule->data.basic);
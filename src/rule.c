@@ -27,12 +27,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 #include "version.h"
 #include "symbol.h"
 #include "atom.h"
 #include "rule.h"
 #include "io.h"
+#include "thread.h"
+#include "context.h"
 
 /* --------------------- Print version information ------------------------- */
 
@@ -300,8 +303,7 @@ int neg_inv(RULE *rule, ATAB *table)
     break;
 
   default:
-    fprintf(stderr, "unknown rule type %i!\n", rule->type);
-    exit(-1);
+    failure(ERROR_UNSUPPORTED, "unknown rule type %i!", rule->type);
     break;
   }
 }
@@ -321,22 +323,9 @@ int check_negative_invisible(RULE *rule, ATAB *table)
 
 void mark_io_atoms(RULE *rule, ATAB *table, int module)
 {
-  ATAB *scan = table;
-
   /* Visible atoms are input atoms by default: */
 
-  while(scan) {
-    int count = scan->count;
-    SYMBOL **names = scan->names;
-    int *statuses = scan->statuses;
-    int i = 0;
-
-    for(i = 1; i <= count; i++)
-      if(names[i])
-	statuses[i] |= MARK_INPUT;
-
-    scan = scan->next;
-  }
+  mark_named(table, MARK_INPUT);
 
   /* Except those who have defining rules: */
 
@@ -409,8 +398,7 @@ void mark_io_atoms(RULE *rule, ATAB *table, int module)
       break;
 
     default:
-      fprintf(stderr, "unsupported rule type %i!\n", rule->type);
-      exit(-1);
+      failure(ERROR_UNSUPPORTED, "unsupported rule type %i!", rule->type);
     }
 
     rule = rule->next;
@@ -419,20 +407,7 @@ void mark_io_atoms(RULE *rule, ATAB *table, int module)
 
 void mark_visible(ATAB *table)
 {
-  ATAB *scan = table;
-
-  while(scan) {
-    int count = scan->count;
-    SYMBOL **names = scan->names;
-    int *statuses = scan->statuses;
-    int i = 0;
-
-    for(i = 1; i <= count; i++)
-      if(names[i])
-	statuses[i] |= MARK_VISIBLE;
-
-    scan = scan->next;
-  }
+  mark_named(table, MARK_VISIBLE);
 
   return;
 }
@@ -469,8 +444,7 @@ void mark_occurrences(RULE *rule, ATAB *table)
       break;
 
     default:
-      fprintf(stderr, "unsupported rule type %i!\n", rule->type);
-      exit(-1);
+      failure(ERROR_UNSUPPORTED, "unsupported rule type %i!", rule->type);
     }
 
     rule = rule->next;
@@ -637,8 +611,7 @@ int len_rule(RULE *rule)
     break;
 
   default:
-    fprintf(stderr, "%s: unknown rule type %i!\n", program_name, rule->type);
-    exit(-1);
+    failure(ERROR_UNSUPPORTED, "unknown rule type %i!", rule->type);
   }
 }
 
@@ -657,22 +630,7 @@ int len(RULE *rule)
 
 int compute_statement_len(ATAB *table)
 {
-  int rvalue = 0;
-
-  while(table) {
-    int count = table->count;
-    int *statuses = table->statuses;
-    int i = 0;
-
-    for(i=1; i<=count; i++) {
-      int status = statuses[i];
-      if(status & MARK_TRUE) rvalue++;
-      if(status & MARK_FALSE) rvalue++;
-      if(status & MARK_INPUT) rvalue++;
-    }
-    table = table->next;
-  }
-  return rvalue;
+  return count_statuses(table, MARK_TRUE|MARK_FALSE|MARK_INPUT, 0);
 }
 
 int number_of_rules(RULE *program)
@@ -699,22 +657,182 @@ RULE *append_rules(RULE *program, RULE *rules)
   return program;
 }
 
+/* ----------------------------- Rule arenas ------------------------------ */
+
+#define RULE_BLOCK_SIZE (1<<22)  /* Default size of an arena block */
+#define RULE_ALIGN 8             /* Alignment of allocated objects */
+
+RULE_ARENA *new_rule_arena()
+{
+  RULE_ARENA *arena = (RULE_ARENA *)malloc(sizeof(RULE_ARENA));
+
+  arena->blocks = NULL;
+
+  return arena;
+}
+
+/* Set the arena used by read_program, read_cnf, and copy_rule; the
+   previous one is returned */
+
+RULE_ARENA *get_rule_arena()
+{
+  return current_context->rule_arena;
+}
+
+RULE_ARENA *use_rule_arena(RULE_ARENA *arena)
+{
+  RULE_ARENA *previous = current_context->rule_arena;
+
+  current_context->rule_arena = arena;
+
+  return previous;
+}
+
+#define RULE_BLOCK_HEADER \
+  ((sizeof(RULE_BLOCK) + RULE_ALIGN-1) & ~(size_t)(RULE_ALIGN-1))
+
+RULE_BLOCK *new_rule_block(size_t block_size)
+{
+  RULE_BLOCK *block = (RULE_BLOCK *)malloc(block_size);
+
+  if(!block)
+    failure(ERROR_MEMORY, "out of memory!");
+  block->free = (char *)block + RULE_BLOCK_HEADER;
+  block->end = (char *)block + block_size;
+  block->next = NULL;
+
+  return block;
+}
+
+void *arena_alloc(RULE_ARENA *arena, size_t size)
+{
+  RULE_BLOCK *block = arena->blocks;
+  char *space = NULL;
+
+  size = (size + RULE_ALIGN-1) & ~(size_t)(RULE_ALIGN-1);
+
+  if(!block || (size_t)(block->end - block->free) < size) {
+    size_t block_size = RULE_BLOCK_SIZE;
+
+    if(size > block_size/4)  /* A block of its own */
+      block_size = RULE_BLOCK_HEADER + size;
+
+    block = new_rule_block(block_size);
+
+    if(arena->blocks && size > RULE_BLOCK_SIZE/4) {
+      /* Do not waste the current block */
+      block->next = arena->blocks->next;
+      arena->blocks->next = block;
+    } else {
+      block->next = arena->blocks;
+      arena->blocks = block;
+    }
+  }
+
+  space = block->free;
+  block->free += size;
+
+  return (void *)space;
+}
+
+/* Make the whole arena available again (the rules in it are lost); a
+   single block covering all previous ones is kept so that reusing the
+   arena for similar rules allocates nothing */
+
+void reset_rule_arena(RULE_ARENA *arena)
+{
+  RULE_BLOCK *block = arena->blocks;
+
+  if(block && block->next) {
+    size_t total = 0;
+
+    while(block) {
+      RULE_BLOCK *next = block->next;
+
+      total += block->end - (char *)block;
+      free(block);
+      block = next;
+    }
+    arena->blocks = new_rule_block(total);
+  } else if(block)
+    block->free = (char *)block + RULE_BLOCK_HEADER;
+
+  return;
+}
+
+/* Allocate from the current arena if any */
+
+void *rule_alloc(size_t size)
+{
+  RULE_ARENA *arena = current_context->rule_arena;
+
+  if(arena)
+    return arena_alloc(arena, size);
+
+  return malloc(size);
+}
+
+/* Move the blocks of arena2 to arena1 (arena2 is freed) */
+
+void merge_rule_arenas(RULE_ARENA *arena1, RULE_ARENA *arena2)
+{
+  RULE_BLOCK *block = arena2->blocks;
+
+  while(block) {
+    RULE_BLOCK *next = block->next;
+
+    if(arena1->blocks) {
+      block->next = arena1->blocks->next;
+      arena1->blocks->next = block;
+    } else {
+      block->next = NULL;
+      arena1->blocks = block;
+    }
+    block = next;
+  }
+
+  free(arena2);
+
+  return;
+}
+
+/* Release all rules allocated from the arena at once */
+
+void free_rule_arena(RULE_ARENA *arena)
+{
+  RULE_BLOCK *block = arena->blocks;
+
+  while(block) {
+    RULE_BLOCK *next = block->next;
+
+    free(block);
+    block = next;
+  }
+
+  if(current_context->rule_arena == arena)
+    current_context->rule_arena = NULL;
+  free(arena);
+
+  return;
+}
+
 RULE *copy_rule(RULE *rule)
 {
-  RULE *new = (RULE *)malloc(sizeof(RULE));
+  RULE *new = (RULE *)rule_alloc(sizeof(RULE));
   int type = rule->type;
 
   new->type = type;
+  new->arena = current_context->rule_arena ? RULE_IN_ARENA : 0;
   switch(type) {
   case TYPE_BASIC:
-    { BASIC_RULE *basic = (BASIC_RULE *)malloc(sizeof(BASIC_RULE));
+    { BASIC_RULE *basic = (BASIC_RULE *)rule_alloc(sizeof(BASIC_RULE));
       int pos_cnt = get_pos_cnt(rule);
       int neg_cnt = get_neg_cnt(rule);
 
       new->data.basic = basic;
       basic->head = get_head(rule);
       basic->neg_cnt = neg_cnt;
-      basic->neg = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      basic->neg = (int *)rule_alloc((neg_cnt+pos_cnt)*sizeof(int));
       basic->pos_cnt = pos_cnt;
       basic->pos = &((basic->neg)[neg_cnt]);
       memcpy(basic->neg, get_neg(rule), neg_cnt*sizeof(int));
@@ -724,7 +842,7 @@ RULE *copy_rule(RULE *rule)
 
   case TYPE_CONSTRAINT:
     { CONSTRAINT_RULE *constraint =
-	(CONSTRAINT_RULE *)malloc(sizeof(CONSTRAINT_RULE));
+	(CONSTRAINT_RULE *)rule_alloc(sizeof(CONSTRAINT_RULE));
       int pos_cnt = get_pos_cnt(rule);
       int neg_cnt = get_neg_cnt(rule);
 
@@ -732,7 +850,8 @@ RULE *copy_rule(RULE *rule)
       
       constraint->neg_cnt = neg_cnt;
       constraint->head = get_head(rule);
-      constraint->neg = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      constraint->bound = rule->data.constraint->bound;
+      constraint->neg = (int *)rule_alloc((neg_cnt+pos_cnt)*sizeof(int));
       constraint->pos_cnt = pos_cnt;
       constraint->pos = &((constraint->neg)[neg_cnt]);
       memcpy(constraint->neg, get_neg(rule), neg_cnt*sizeof(int));
@@ -742,7 +861,7 @@ RULE *copy_rule(RULE *rule)
 
   case TYPE_CHOICE:
     { CHOICE_RULE *choice =
-	(CHOICE_RULE *)malloc(sizeof(CHOICE_RULE));
+	(CHOICE_RULE *)rule_alloc(sizeof(CHOICE_RULE));
       int head_cnt = get_head_cnt(rule);
       int pos_cnt = get_pos_cnt(rule);
       int neg_cnt = get_neg_cnt(rule);
@@ -750,11 +869,11 @@ RULE *copy_rule(RULE *rule)
       new->data.choice = choice;
       
       choice->head_cnt = head_cnt;
-      choice->head = (int *)malloc(head_cnt*sizeof(int));
+      choice->head = (int *)rule_alloc(head_cnt*sizeof(int));
       memcpy(choice->head, get_heads(rule), head_cnt*sizeof(int));
 
       choice->neg_cnt = neg_cnt;
-      choice->neg = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      choice->neg = (int *)rule_alloc((neg_cnt+pos_cnt)*sizeof(int));
       choice->pos_cnt = pos_cnt;
       choice->pos = &((choice->neg)[neg_cnt]);
       memcpy(choice->neg, get_neg(rule), neg_cnt*sizeof(int));
@@ -764,7 +883,7 @@ RULE *copy_rule(RULE *rule)
 
   case TYPE_INTEGRITY:
     { INTEGRITY_RULE *integrity =
-	(INTEGRITY_RULE *)malloc(sizeof(INTEGRITY_RULE));
+	(INTEGRITY_RULE *)rule_alloc(sizeof(INTEGRITY_RULE));
       int head_cnt = get_head_cnt(rule);
       int pos_cnt = get_pos_cnt(rule);
       int neg_cnt = get_neg_cnt(rule);
@@ -772,7 +891,7 @@ RULE *copy_rule(RULE *rule)
       new->data.integrity = integrity;
       
       integrity->neg_cnt = neg_cnt;
-      integrity->neg = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      integrity->neg = (int *)rule_alloc((neg_cnt+pos_cnt)*sizeof(int));
       integrity->pos_cnt = pos_cnt;
       integrity->pos = &((integrity->neg)[neg_cnt]);
       memcpy(integrity->neg, get_neg(rule), neg_cnt*sizeof(int));
@@ -782,7 +901,7 @@ RULE *copy_rule(RULE *rule)
 
   case TYPE_WEIGHT:
     { WEIGHT_RULE *weight =
-	(WEIGHT_RULE *)malloc(sizeof(WEIGHT_RULE));
+	(WEIGHT_RULE *)rule_alloc(sizeof(WEIGHT_RULE));
       int pos_cnt = get_pos_cnt(rule);
       int neg_cnt = get_neg_cnt(rule);
       int *weights = rule->data.weight->weight;
@@ -790,14 +909,15 @@ RULE *copy_rule(RULE *rule)
       new->data.weight = weight;
       
       weight->head = get_head(rule);
+      weight->bound = rule->data.weight->bound;
       weight->neg_cnt = neg_cnt;
-      weight->neg = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      weight->neg = (int *)rule_alloc(2*(neg_cnt+pos_cnt)*sizeof(int));
       weight->pos_cnt = pos_cnt;
       weight->pos = &((weight->neg)[neg_cnt]);
       memcpy(weight->neg, get_neg(rule), neg_cnt*sizeof(int));
       memcpy(weight->pos, get_pos(rule), pos_cnt*sizeof(int));
 
-      weight->weight = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      weight->weight = &((weight->neg)[neg_cnt+pos_cnt]);  /* Cf. free_rule */
       memcpy(weight->weight, weights, (neg_cnt+pos_cnt)*sizeof(int));
 
     }
@@ -805,7 +925,7 @@ RULE *copy_rule(RULE *rule)
 
   case TYPE_OPTIMIZE:
     { OPTIMIZE_RULE *optimize =
-	(OPTIMIZE_RULE *)malloc(sizeof(OPTIMIZE_RULE));
+	(OPTIMIZE_RULE *)rule_alloc(sizeof(OPTIMIZE_RULE));
       int pos_cnt = get_pos_cnt(rule);
       int neg_cnt = get_neg_cnt(rule);
       int *weight = rule->data.optimize->weight;
@@ -813,20 +933,21 @@ RULE *copy_rule(RULE *rule)
       new->data.optimize = optimize;
       
       optimize->neg_cnt = neg_cnt;
-      optimize->neg = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      optimize->neg = (int *)rule_alloc(2*(neg_cnt+pos_cnt)*sizeof(int));
       optimize->pos_cnt = pos_cnt;
       optimize->pos = &((optimize->neg)[neg_cnt]);
       memcpy(optimize->neg, get_neg(rule), neg_cnt*sizeof(int));
       memcpy(optimize->pos, get_pos(rule), pos_cnt*sizeof(int));
 
-      optimize->weight = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      /* Weights share the block of literals (cf. free_rule) */
+      optimize->weight = &((optimize->neg)[neg_cnt+pos_cnt]);
       memcpy(optimize->weight, weight, (neg_cnt+pos_cnt)*sizeof(int));
     }
     break;
 
   case TYPE_DISJUNCTIVE:
     { DISJUNCTIVE_RULE *disjunctive =
-	(DISJUNCTIVE_RULE *)malloc(sizeof(DISJUNCTIVE_RULE));
+	(DISJUNCTIVE_RULE *)rule_alloc(sizeof(DISJUNCTIVE_RULE));
       int head_cnt = get_head_cnt(rule);
       int pos_cnt = get_pos_cnt(rule);
       int neg_cnt = get_neg_cnt(rule);
@@ -834,11 +955,11 @@ RULE *copy_rule(RULE *rule)
       new->data.disjunctive = disjunctive;
       
       disjunctive->head_cnt = head_cnt;
-      disjunctive->head = (int *)malloc(head_cnt*sizeof(int));
+      disjunctive->head = (int *)rule_alloc(head_cnt*sizeof(int));
       memcpy(disjunctive->head, get_heads(rule), head_cnt*sizeof(int));
 
       disjunctive->neg_cnt = neg_cnt;
-      disjunctive->neg = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      disjunctive->neg = (int *)rule_alloc((neg_cnt+pos_cnt)*sizeof(int));
       disjunctive->pos_cnt = pos_cnt;
       disjunctive->pos = &((disjunctive->neg)[neg_cnt]);
       memcpy(disjunctive->neg, get_neg(rule), neg_cnt*sizeof(int));
@@ -847,16 +968,16 @@ RULE *copy_rule(RULE *rule)
     break;
 
   case TYPE_CLAUSE:
-    { CLAUSE *clause = (CLAUSE *)malloc(sizeof(CLAUSE));
+    { CLAUSE *clause = (CLAUSE *)rule_alloc(sizeof(CLAUSE));
       int head_cnt = get_head_cnt(rule);
       int pos_cnt = get_pos_cnt(rule);
       int neg_cnt = get_neg_cnt(rule);
-      int weight = (rule->data.clause)->weight;
+      long weight = (rule->data.clause)->weight;
 
       new->data.clause = clause;
       
       clause->neg_cnt = neg_cnt;
-      clause->neg = (int *)malloc((neg_cnt+pos_cnt)*sizeof(int));
+      clause->neg = (int *)rule_alloc((neg_cnt+pos_cnt)*sizeof(int));
       clause->pos_cnt = pos_cnt;
       clause->pos = &((clause->neg)[neg_cnt]);
       memcpy(clause->neg, get_neg(rule), neg_cnt*sizeof(int));
@@ -870,3 +991,968 @@ RULE *copy_rule(RULE *rule)
 
   return new;
 }
+
+/* ----------------------- Rules in contiguous arrays ---------------------- */
+
+RTAB *new_rtab(long size, long pool_size)
+{
+  RTAB *rules = (RTAB *)malloc(sizeof(RTAB));
+
+  if(size < 1)
+    size = 1;
+  if(pool_size < 1)
+    pool_size = 1;
+
+  rules->count = 0;
+  rules->size = size;
+  rules->types = (int *)malloc(size*sizeof(int));
+  rules->starts = (long *)malloc(size*sizeof(long));
+  rules->head_cnts = (int *)malloc(size*sizeof(int));
+  rules->neg_cnts = (int *)malloc(size*sizeof(int));
+  rules->pos_cnts = (int *)malloc(size*sizeof(int));
+  rules->bounds = (long *)malloc(size*sizeof(long));
+  rules->used = 0;
+  rules->pool_size = pool_size;
+  rules->pool = (int *)malloc(pool_size*sizeof(int));
+
+  if(!rules->types || !rules->starts || !rules->head_cnts ||
+     !rules->neg_cnts || !rules->pos_cnts || !rules->bounds || !rules->pool)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  return rules;
+}
+
+void free_rtab(RTAB *rules)
+{
+  free(rules->types);
+  free(rules->starts);
+  free(rules->head_cnts);
+  free(rules->neg_cnts);
+  free(rules->pos_cnts);
+  free(rules->bounds);
+  free(rules->pool);
+  free(rules);
+
+  return;
+}
+
+/* Make room for one more rule with pool_needed literals and weights */
+
+void grow_rtab(RTAB *rules, long pool_needed)
+{
+  if(rules->count == rules->size) {
+    long size = 2*rules->size;
+
+    rules->types = (int *)realloc(rules->types, size*sizeof(int));
+    rules->starts = (long *)realloc(rules->starts, size*sizeof(long));
+    rules->head_cnts = (int *)realloc(rules->head_cnts, size*sizeof(int));
+    rules->neg_cnts = (int *)realloc(rules->neg_cnts, size*sizeof(int));
+    rules->pos_cnts = (int *)realloc(rules->pos_cnts, size*sizeof(int));
+    rules->bounds = (long *)realloc(rules->bounds, size*sizeof(long));
+    rules->size = size;
+  }
+
+  if(rules->pool_size - rules->used < pool_needed) {
+    long pool_size = 2*rules->pool_size;
+
+    while(pool_size - rules->used < pool_needed)
+      pool_size *= 2;
+    rules->pool = (int *)realloc(rules->pool, pool_size*sizeof(int));
+    rules->pool_size = pool_size;
+  }
+
+  if(!rules->types || !rules->starts || !rules->head_cnts ||
+     !rules->neg_cnts || !rules->pos_cnts || !rules->bounds || !rules->pool)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  return;
+}
+
+/* Add a rule whose literals and weights have been written in place at
+   the end of the pool (see grow_rtab); the index of the rule is
+   returned */
+
+long put_rtab(RTAB *rules, int type, int head_cnt, int neg_cnt,
+	      int pos_cnt, long bound)
+{
+  long i = rules->count;
+  int weight_cnt = 0;
+
+  if(type == TYPE_WEIGHT || type == TYPE_OPTIMIZE)
+    weight_cnt = neg_cnt+pos_cnt;
+
+  (rules->types)[i] = type;
+  (rules->starts)[i] = rules->used;
+  (rules->head_cnts)[i] = head_cnt;
+  (rules->neg_cnts)[i] = neg_cnt;
+  (rules->pos_cnts)[i] = pos_cnt;
+  (rules->bounds)[i] = bound;
+
+  rules->used += head_cnt+neg_cnt+pos_cnt+weight_cnt;
+  rules->count++;
+
+  return i;
+}
+
+/* Add a rule given by its parts; the index of the rule is returned */
+
+long add_rtab(RTAB *rules, int type, int head_cnt, int *heads,
+	      int neg_cnt, int *neg, int pos_cnt, int *pos,
+	      int *weights, long bound)
+{
+  int weight_cnt = weights ? neg_cnt+pos_cnt : 0;
+  int *scan = NULL;
+
+  switch(type) {
+  case TYPE_BASIC:
+  case TYPE_CONSTRAINT:
+  case TYPE_CHOICE:
+  case TYPE_INTEGRITY:
+  case TYPE_WEIGHT:
+  case TYPE_OPTIMIZE:
+  case TYPE_DISJUNCTIVE:
+  case TYPE_CLAUSE:
+    break;
+  default:
+    failure(ERROR_UNSUPPORTED, "unsupported rule type %i!", type);
+  }
+
+  grow_rtab(rules, head_cnt+neg_cnt+pos_cnt+weight_cnt);
+
+  scan = &(rules->pool)[rules->used];
+  if(head_cnt)
+    memcpy(scan, heads, head_cnt*sizeof(int));
+  scan += head_cnt;
+  if(neg_cnt)
+    memcpy(scan, neg, neg_cnt*sizeof(int));
+  scan += neg_cnt;
+  if(pos_cnt)
+    memcpy(scan, pos, pos_cnt*sizeof(int));
+  scan += pos_cnt;
+  if(weight_cnt)
+    memcpy(scan, weights, weight_cnt*sizeof(int));
+
+  return put_rtab(rules, type, head_cnt, neg_cnt, pos_cnt, bound);
+}
+
+int *get_weights(RULE *rule)
+{
+  switch(rule->type) {
+  case TYPE_WEIGHT:   return rule->data.weight->weight;
+  case TYPE_OPTIMIZE: return rule->data.optimize->weight;
+  default:
+    return NULL;
+  }
+}
+
+long get_bound(RULE *rule)
+{
+  switch(rule->type) {
+  case TYPE_CONSTRAINT: return rule->data.constraint->bound;
+  case TYPE_WEIGHT:     return rule->data.weight->bound;
+  case TYPE_CLAUSE:     return rule->data.clause->weight;
+  default:
+    return 0;
+  }
+}
+
+long add_rule_to_rtab(RTAB *rules, RULE *rule)
+{
+  return add_rtab(rules, rule->type,
+		  get_head_cnt(rule), get_heads(rule),
+		  get_neg_cnt(rule), get_neg(rule),
+		  get_pos_cnt(rule), get_pos(rule),
+		  get_weights(rule), get_bound(rule));
+}
+
+/* Move the rules of rules2 to the end of rules1 (rules2 is freed); the
+   arrays of rules1 are extended exactly so that large tables are not
+   doubled */
+
+void append_rtab(RTAB *rules1, RTAB *rules2)
+{
+  long count = rules1->count + rules2->count;
+  long used = rules1->used + rules2->used;
+  long offset = rules1->used;
+  long i = 0;
+
+  if(count > rules1->size) {
+    rules1->types = (int *)realloc(rules1->types, count*sizeof(int));
+    rules1->starts = (long *)realloc(rules1->starts, count*sizeof(long));
+    rules1->head_cnts = (int *)realloc(rules1->head_cnts, count*sizeof(int));
+    rules1->neg_cnts = (int *)realloc(rules1->neg_cnts, count*sizeof(int));
+    rules1->pos_cnts = (int *)realloc(rules1->pos_cnts, count*sizeof(int));
+    rules1->bounds = (long *)realloc(rules1->bounds, count*sizeof(long));
+    rules1->size = count;
+  }
+
+  if(used > rules1->pool_size) {
+    rules1->pool = (int *)realloc(rules1->pool, used*sizeof(int));
+    rules1->pool_size = used;
+  }
+
+  if(!rules1->types || !rules1->starts || !rules1->head_cnts ||
+     !rules1->neg_cnts || !rules1->pos_cnts || !rules1->bounds ||
+     !rules1->pool)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  memcpy(&(rules1->types)[rules1->count], rules2->types,
+	 rules2->count*sizeof(int));
+  for(i=0; i<rules2->count; i++)
+    (rules1->starts)[rules1->count+i] = (rules2->starts)[i] + offset;
+  memcpy(&(rules1->head_cnts)[rules1->count], rules2->head_cnts,
+	 rules2->count*sizeof(int));
+  memcpy(&(rules1->neg_cnts)[rules1->count], rules2->neg_cnts,
+	 rules2->count*sizeof(int));
+  memcpy(&(rules1->pos_cnts)[rules1->count], rules2->pos_cnts,
+	 rules2->count*sizeof(int));
+  memcpy(&(rules1->bounds)[rules1->count], rules2->bounds,
+	 rules2->count*sizeof(long));
+  memcpy(&(rules1->pool)[offset], rules2->pool, rules2->used*sizeof(int));
+
+  rules1->count = count;
+  rules1->used = used;
+  free_rtab(rules2);
+
+  return;
+}
+
+RTAB *program_to_rtab(RULE *program)
+{
+  RULE *scan = program;
+  RTAB *rules = NULL;
+  long count = 0;
+  long pool_size = 0;
+
+  /* Reserve exactly the space needed */
+
+  while(scan) {
+    int lits = get_neg_cnt(scan) + get_pos_cnt(scan);
+
+    count++;
+    pool_size += get_head_cnt(scan) + lits;
+    if(get_weights(scan))
+      pool_size += lits;
+    scan = scan->next;
+  }
+
+  rules = new_rtab(count, pool_size);
+
+  for(scan = program; scan; scan = scan->next)
+    (void) add_rule_to_rtab(rules, scan);
+
+  return rules;
+}
+
+/* Present the i-th rule as a RULE referring to the arrays of rules; data
+   provides space for the type-specific part (nothing is allocated) */
+
+RULE *view_rule(RTAB *rules, long i, RULE *view, RULE_DATA *data)
+{
+  int type = (rules->types)[i];
+  int *heads = RTAB_HEADS(rules, i);
+  int *neg = RTAB_NEG(rules, i);
+  int *pos = RTAB_POS(rules, i);
+  int *weights = RTAB_WEIGHTS(rules, i);
+  int head_cnt = (rules->head_cnts)[i];
+  int neg_cnt = (rules->neg_cnts)[i];
+  int pos_cnt = (rules->pos_cnts)[i];
+  long bound = (rules->bounds)[i];
+
+  view->type = type;
+  view->arena = RULE_IN_ARENA;  /* Not to be freed */
+  view->next = NULL;
+
+  switch(type) {
+  case TYPE_BASIC:
+    view->data.basic = &(data->basic);
+    data->basic.head = heads[0];
+    data->basic.neg_cnt = neg_cnt;
+    data->basic.neg = neg;
+    data->basic.pos_cnt = pos_cnt;
+    data->basic.pos = pos;
+    break;
+
+  case TYPE_CONSTRAINT:
+    view->data.constraint = &(data->constraint);
+    data->constraint.head = heads[0];
+    data->constraint.bound = (int)bound;
+    data->constraint.neg_cnt = neg_cnt;
+    data->constraint.neg = neg;
+    data->constraint.pos_cnt = pos_cnt;
+    data->constraint.pos = pos;
+    break;
+
+  case TYPE_CHOICE:
+    view->data.choice = &(data->choice);
+    data->choice.head_cnt = head_cnt;
+    data->choice.head = heads;
+    data->choice.neg_cnt = neg_cnt;
+    data->choice.neg = neg;
+    data->choice.pos_cnt = pos_cnt;
+    data->choice.pos = pos;
+    break;
+
+  case TYPE_INTEGRITY:
+    view->data.integrity = &(data->integrity);
+    data->integrity.neg_cnt = neg_cnt;
+    data->integrity.neg = neg;
+    data->integrity.pos_cnt = pos_cnt;
+    data->integrity.pos = pos;
+    break;
+
+  case TYPE_WEIGHT:
+    view->data.weight = &(data->weight);
+    data->weight.head = heads[0];
+    data->weight.bound = (int)bound;
+    data->weight.neg_cnt = neg_cnt;
+    data->weight.neg = neg;
+    data->weight.pos_cnt = pos_cnt;
+    data->weight.pos = pos;
+    data->weight.weight = weights;
+    break;
+
+  case TYPE_OPTIMIZE:
+    view->data.optimize = &(data->optimize);
+    data->optimize.neg_cnt = neg_cnt;
+    data->optimize.neg = neg;
+    data->optimize.pos_cnt = pos_cnt;
+    data->optimize.pos = pos;
+    data->optimize.weight = weights;
+    break;
+
+  case TYPE_DISJUNCTIVE:
+    view->data.disjunctive = &(data->disjunctive);
+    data->disjunctive.head_cnt = head_cnt;
+    data->disjunctive.head = heads;
+    data->disjunctive.neg_cnt = neg_cnt;
+    data->disjunctive.neg = neg;
+    data->disjunctive.pos_cnt = pos_cnt;
+    data->disjunctive.pos = pos;
+    break;
+
+  case TYPE_CLAUSE:
+    view->data.clause = &(data->clause);
+    data->clause.neg_cnt = neg_cnt;
+    data->clause.neg = neg;
+    data->clause.pos_cnt = pos_cnt;
+    data->clause.pos = pos;
+    data->clause.weight = bound;
+    break;
+
+  default:
+    break;
+  }
+
+  return view;
+}
+
+RULE *rtab_to_program(RTAB *rules)
+{
+  RULE *program = NULL;
+  RULE *last = NULL;
+  long i = 0;
+
+  for(i=0; i<rules->count; i++) {
+    RULE view;
+    RULE_DATA data;
+    RULE *new = copy_rule(view_rule(rules, i, &view, &data));
+
+    if(last)
+      last->next = new;
+    else
+      program = new;
+    last = new;
+  }
+
+  return program;
+}
+
+/* The following passes visit the rules in the order of the pool */
+
+int check_negative_invisible_rtab(RTAB *rules, ATAB *table)
+{
+  int rvalue = 0;
+  long i = 0;
+
+  for(i=0; i<rules->count; i++) {
+    int type = (rules->types)[i];
+
+    switch(type) {
+    case TYPE_CHOICE:
+    case TYPE_DISJUNCTIVE:
+      /* Heads are covered, too */
+      rvalue |= neg_inv_list((rules->head_cnts)[i] + (rules->neg_cnts)[i],
+			     RTAB_HEADS(rules, i), table);
+      break;
+
+    case TYPE_BASIC:
+    case TYPE_CONSTRAINT:
+    case TYPE_INTEGRITY:
+    case TYPE_WEIGHT:
+    case TYPE_OPTIMIZE:
+      rvalue |= neg_inv_list((rules->neg_cnts)[i], RTAB_NEG(rules, i), table);
+      break;
+
+    default:
+      failure(ERROR_UNSUPPORTED, "unknown rule type %i!", type);
+      break;
+    }
+  }
+
+  return rvalue;
+}
+
+void mark_io_atoms_rtab(RTAB *rules, ATAB *table, int module)
+{
+  long i = 0;
+
+  /* Visible atoms are input atoms by default: */
+
+  mark_named(table, MARK_INPUT);
+
+  /* Except those who have defining rules: */
+
+  for(i=0; i<rules->count; i++) {
+    int cnt = (rules->head_cnts)[i];
+    int *head = RTAB_HEADS(rules, i);
+
+    if((rules->types)[i] == TYPE_CLAUSE)
+      failure(ERROR_UNSUPPORTED, "unsupported rule type %i!",
+	      (rules->types)[i]);
+
+    while(cnt--) {
+      clear_status(table, *head, MARK_INPUT);
+      if(module)
+	set_module(table, *head, module);
+      head++;
+    }
+  }
+
+  return;
+}
+
+void mark_occurrences_rtab(RTAB *rules, ATAB *table)
+{
+  long i = 0;
+
+  for(i=0; i<rules->count; i++) {
+    set_statuses(table, (rules->head_cnts)[i], RTAB_HEADS(rules, i),
+		 MARK_HEADOCC);
+    set_statuses(table, (rules->pos_cnts)[i], RTAB_POS(rules, i),
+		 MARK_POSOCC);
+    set_statuses(table, (rules->neg_cnts)[i], RTAB_NEG(rules, i),
+		 MARK_NEGOCC);
+  }
+
+  return;
+}
+
+int len_rtab(RTAB *rules)
+{
+  int rvalue = 0;
+  long i = 0;
+
+  /* Cf. len_rule */
+
+  for(i=0; i<rules->count; i++) {
+    int lits = (rules->neg_cnts)[i] + (rules->pos_cnts)[i];
+
+    switch((rules->types)[i]) {
+    case TYPE_BASIC:       rvalue += lits + 4; break;
+    case TYPE_CONSTRAINT:  rvalue += lits + 5; break;
+    case TYPE_CHOICE:      rvalue += (rules->head_cnts)[i] + lits + 4; break;
+    case TYPE_INTEGRITY:   rvalue += lits + 3; break;
+    case TYPE_WEIGHT:      rvalue += 2*lits + 5; break;
+    case TYPE_OPTIMIZE:    rvalue += 2*lits + 4; break;
+    case TYPE_DISJUNCTIVE: rvalue += lits + 4; break;
+    case TYPE_CLAUSE:
+      rvalue += ((rules->bounds)[i] > 0) ? lits + 2 : lits + 1;
+      break;
+    default:
+      break;
+    }
+  }
+
+  return rvalue;
+}
+
+/* ----------------------- Occurrences of atoms ---------------------------- */
+
+/* The index is built in two passes over the rules: occurrences are
+   first counted and then filled in.  With several threads the rules are
+   split in chunks processed in parallel; counters are then updated
+   atomically and the lists are sorted afterwards so that the result does
+   not depend on scheduling. */
+
+typedef struct ojob {
+  OTAB *occurrences;
+  RTAB *rtab;          /* Rules in a table (if not in a list) */
+  int jobs;            /* Number of chunks */
+  int parallel;        /* Update counters atomically */
+  int *maxima;         /* Largest atom of each chunk */
+  int *cursors[3];     /* Next free positions in the lists */
+} OJOB;
+
+RULE *occurring_rule(OJOB *job, int i, RULE *view, RULE_DATA *data)
+{
+  if(job->rtab)
+    return view_rule(job->rtab, i, view, data);
+  else
+    return (job->occurrences->rules)[i];
+}
+
+int occurring_atoms(RULE *rule, int kind, int **atoms)
+{
+  switch(kind) {
+  case OCC_HEAD:
+    *atoms = get_heads(rule);
+    return get_head_cnt(rule);
+  case OCC_POS:
+    *atoms = get_pos(rule);
+    return get_pos_cnt(rule);
+  default:
+    *atoms = get_neg(rule);
+    return get_neg_cnt(rule);
+  }
+}
+
+void find_max_occurrence(void *data, int index)
+{
+  OJOB *job = (OJOB *)data;
+  int count = job->occurrences->count;
+  int first = (int)((long)count*index/job->jobs);
+  int last = (int)((long)count*(index+1)/job->jobs);
+  int max = 0;
+  int i = 0;
+
+  for(i=first; i<last; i++) {
+    RULE view;
+    RULE_DATA rdata;
+    RULE *rule = occurring_rule(job, i, &view, &rdata);
+    int kind = 0;
+
+    for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+      int *atoms = NULL;
+      int cnt = occurring_atoms(rule, kind, &atoms);
+
+      while(cnt--) {
+	if(*atoms > max)
+	  max = *atoms;
+	atoms++;
+      }
+    }
+  }
+  (job->maxima)[index] = max;
+
+  return;
+}
+
+void count_occurrences(void *data, int index)
+{
+  OJOB *job = (OJOB *)data;
+  OTAB *occurrences = job->occurrences;
+  int count = occurrences->count;
+  int first = (int)((long)count*index/job->jobs);
+  int last = (int)((long)count*(index+1)/job->jobs);
+  int i = 0;
+
+  for(i=first; i<last; i++) {
+    RULE view;
+    RULE_DATA rdata;
+    RULE *rule = occurring_rule(job, i, &view, &rdata);
+    int kind = 0;
+
+    for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+      int *counts = (occurrences->starts)[kind];
+      int *atoms = NULL;
+      int cnt = occurring_atoms(rule, kind, &atoms);
+
+      /* The count of atom a is kept at counts[a+1] (see index_atoms) */
+
+#ifdef ATOMIC_INCREMENT
+      if(job->parallel) {
+	while(cnt--)
+	  (void) ATOMIC_INCREMENT(&counts[*(atoms++)+1]);
+	continue;
+      }
+#endif
+      while(cnt--)
+	counts[*(atoms++)+1]++;
+    }
+  }
+
+  return;
+}
+
+void fill_occurrences(void *data, int index)
+{
+  OJOB *job = (OJOB *)data;
+  OTAB *occurrences = job->occurrences;
+  int count = occurrences->count;
+  int first = (int)((long)count*index/job->jobs);
+  int last = (int)((long)count*(index+1)/job->jobs);
+  int i = 0;
+
+  for(i=first; i<last; i++) {
+    RULE view;
+    RULE_DATA rdata;
+    RULE *rule = occurring_rule(job, i, &view, &rdata);
+    int kind = 0;
+
+    for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+      int *cursors = (job->cursors)[kind];
+      int *occs = (occurrences->occs)[kind];
+      int *atoms = NULL;
+      int cnt = occurring_atoms(rule, kind, &atoms);
+
+#ifdef ATOMIC_INCREMENT
+      if(job->parallel) {
+	while(cnt--)
+	  occs[ATOMIC_INCREMENT(&cursors[*(atoms++)])] = i;
+	continue;
+      }
+#endif
+      while(cnt--)
+	occs[cursors[*(atoms++)]++] = i;
+    }
+  }
+
+  return;
+}
+
+int compare_rule_numbers(const void *p1, const void *p2)
+{
+  int i1 = *(const int *)p1;
+  int i2 = *(const int *)p2;
+
+  return (i1 > i2) - (i1 < i2);
+}
+
+void sort_occurrences(void *data, int index)
+{
+  OJOB *job = (OJOB *)data;
+  OTAB *occurrences = job->occurrences;
+  int atoms = occurrences->atoms;
+  int first = 1 + (int)((long)atoms*index/job->jobs);
+  int last = 1 + (int)((long)atoms*(index+1)/job->jobs);
+  int kind = 0;
+  int a = 0;
+
+  for(kind=OCC_HEAD; kind<=OCC_NEG; kind++)
+    for(a=first; a<last; a++) {
+      int cnt = OTAB_CNT(occurrences, kind, a);
+      int *occs = OTAB_RULES(occurrences, kind, a);
+
+      if(cnt > 16)
+	qsort(occs, cnt, sizeof(int), compare_rule_numbers);
+      else {  /* Insertion sort */
+	int i = 0;
+
+	for(i=1; i<cnt; i++) {
+	  int number = occs[i];
+	  int j = i;
+
+	  while(j > 0 && occs[j-1] > number) {
+	    occs[j] = occs[j-1];
+	    j--;
+	  }
+	  occs[j] = number;
+	}
+      }
+    }
+
+  return;
+}
+
+OTAB *index_atoms(OTAB *occurrences, RTAB *rtab)
+{
+  OJOB job;
+  int atoms = 0;
+  int kind = 0;
+  int i = 0;
+
+  job.occurrences = occurrences;
+  job.rtab = rtab;
+  job.jobs = 1;
+  job.parallel = 0;
+
+#ifdef ATOMIC_INCREMENT
+  if(worker_threads > 1 && occurrences->count >= 4*worker_threads) {
+    job.jobs = 4*worker_threads;
+    job.parallel = -1;
+  }
+#endif
+
+  job.maxima = (int *)malloc(job.jobs * sizeof(int));
+  if(!job.maxima)
+    failure(ERROR_MEMORY, "out of memory!");
+  run_parallel(job.jobs, find_max_occurrence, &job);
+  for(i=0; i<job.jobs; i++)
+    if((job.maxima)[i] > atoms)
+      atoms = (job.maxima)[i];
+  free(job.maxima);
+  occurrences->atoms = atoms;
+
+  for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+    (occurrences->starts)[kind] = (int *)calloc(atoms+2, sizeof(int));
+    (job.cursors)[kind] = NULL;
+    (occurrences->occs)[kind] = NULL;
+    if(!(occurrences->starts)[kind])
+      failure(ERROR_MEMORY, "out of memory!");
+  }
+
+  /* First pass: count occurrences */
+
+  run_parallel(job.jobs, count_occurrences, &job);
+
+  for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+    int *starts = (occurrences->starts)[kind];
+    int *cursors = (int *)malloc((atoms+2) * sizeof(int));
+
+    for(i=1; i<=atoms+1; i++)
+      starts[i] += starts[i-1];
+    (occurrences->occs)[kind] =
+      (int *)malloc((starts[atoms+1] > 0 ? starts[atoms+1] : 1)
+		    * sizeof(int));
+    if(!cursors || !(occurrences->occs)[kind])
+      failure(ERROR_MEMORY, "out of memory!");
+    memcpy(cursors, starts, (atoms+2) * sizeof(int));
+    (job.cursors)[kind] = cursors;
+  }
+
+  /* Second pass: fill in the lists */
+
+  run_parallel(job.jobs, fill_occurrences, &job);
+
+  if(job.parallel)
+    run_parallel(job.jobs, sort_occurrences, &job);
+
+  for(kind=OCC_HEAD; kind<=OCC_NEG; kind++)
+    free((job.cursors)[kind]);
+
+  return occurrences;
+}
+
+OTAB *index_occurrences(RULE *program)
+{
+  OTAB *occurrences = (OTAB *)malloc(sizeof(OTAB));
+  int count = number_of_rules(program);
+  int i = 0;
+
+  if(!occurrences ||
+     !(occurrences->rules = (RULE **)malloc((count+1) * sizeof(RULE *))))
+    failure(ERROR_MEMORY, "out of memory!");
+
+  occurrences->count = count;
+  for(i=0; i<count; i++) {
+    (occurrences->rules)[i] = program;
+    program = program->next;
+  }
+
+  return index_atoms(occurrences, NULL);
+}
+
+OTAB *index_occurrences_rtab(RTAB *rules)
+{
+  OTAB *occurrences = (OTAB *)malloc(sizeof(OTAB));
+
+  if(!occurrences)
+    failure(ERROR_MEMORY, "out of memory!");
+  if(rules->count > INT_MAX)
+    failure(ERROR_UNSUPPORTED, "too many rules to index occurrences");
+
+  occurrences->count = (int)rules->count;
+  occurrences->rules = NULL;
+
+  return index_atoms(occurrences, rules);
+}
+
+void free_otab(OTAB *occurrences)
+{
+  int kind = 0;
+
+  for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+    free((occurrences->starts)[kind]);
+    free((occurrences->occs)[kind]);
+  }
+  if(occurrences->rules)
+    free(occurrences->rules);
+  free(occurrences);
+
+  return;
+}
+
+/* ------------------------- Renumbering of atoms -------------------------- */
+
+/* Atoms that occur in the rules of a program, have names, or appear in
+   the compute statement are numbered consecutively from 1 onward in the
+   given order; other atoms are dropped.  Literals are rewritten in place
+   and the table is replaced by a contiguous one.  Cross-references from
+   other tables to the original table are not updated. */
+
+/* Number the atoms depending on root (via the bodies of their defining
+   rules) before the root itself; atoms to be numbered are marked with -1
+   in numbers[] and those on the stack with -2 */
+
+int number_by_dependency(OTAB *occurrences, int root, int *numbers,
+			 int next, int *stack, int *rpos, int *lpos)
+{
+  int depth = 0;
+
+  numbers[root] = -2;
+  rpos[root] = lpos[root] = 0;
+  stack[depth++] = root;
+
+  while(depth) {
+    int atom = stack[depth-1];
+    int cnt = OTAB_CNT(occurrences, OCC_HEAD, atom);
+    int *rules = OTAB_RULES(occurrences, OCC_HEAD, atom);
+    int pushed = 0;
+
+    while(!pushed && rpos[atom] < cnt) {
+      RULE *rule = (occurrences->rules)[rules[rpos[atom]]];
+      int pos_cnt = get_pos_cnt(rule);
+      int neg_cnt = get_neg_cnt(rule);
+
+      if(lpos[atom] < pos_cnt+neg_cnt) {
+	int i = lpos[atom]++;
+	int body = i < pos_cnt ? (get_pos(rule))[i]
+	                       : (get_neg(rule))[i-pos_cnt];
+
+	if(numbers[body] == -1) {
+	  numbers[body] = -2;
+	  rpos[body] = lpos[body] = 0;
+	  stack[depth++] = body;
+	  pushed = -1;
+	}
+      } else {
+	rpos[atom]++;
+	lpos[atom] = 0;
+      }
+    }
+
+    if(!pushed) {
+      numbers[atom] = ++next;
+      depth--;
+    }
+  }
+
+  return next;
+}
+
+ATAB *renumber_atoms(RULE *program, ATAB *table, int order)
+{
+  ATAB *piece = table;
+  RULE *scan = NULL;
+  int size = table ? table_size(table) : 0;
+  int *numbers = NULL;
+  int next = 0;
+  int kind = 0;
+  int atom = 0;
+
+  for(scan=program; scan; scan=scan->next)
+    for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+      int *atoms = NULL;
+      int cnt = occurring_atoms(scan, kind, &atoms);
+
+      while(cnt--)
+	if(atoms[cnt] > size)
+	  size = atoms[cnt];
+    }
+
+  numbers = (int *)calloc(size+1, sizeof(int));
+  if(!numbers)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  /* Mark the atoms to be kept */
+
+  for(scan=program; scan; scan=scan->next)
+    for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+      int *atoms = NULL;
+      int cnt = occurring_atoms(scan, kind, &atoms);
+
+      while(cnt--)
+	numbers[atoms[cnt]] = -1;
+    }
+
+  while(piece) {
+    int offset = piece->offset;
+    int i = 0;
+
+    for(i=1; i<=piece->count; i++)
+      if((piece->names)[i] ||
+	 (get_piece_status(piece, i) & (MARK_TRUE_OR_FALSE|MARK_INPUT)))
+	numbers[offset+i] = -1;
+    piece = piece->next;
+  }
+
+  /* Number the atoms of rules in the requested order */
+
+  if(order == ORDER_BY_OCCURRENCE) {
+
+    for(scan=program; scan; scan=scan->next)
+      for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+	int *atoms = NULL;
+	int cnt = occurring_atoms(scan, kind, &atoms);
+	int i = 0;
+
+	for(i=0; i<cnt; i++)
+	  if(numbers[atoms[i]] < 0)
+	    numbers[atoms[i]] = ++next;
+      }
+
+  } else if(order == ORDER_BY_DEPENDENCY) {
+    OTAB *occurrences = index_occurrences(program);
+    int atoms = occurrences->atoms;
+    int *stack = (int *)malloc((atoms+1)*sizeof(int));
+    int *rpos = (int *)malloc((atoms+1)*sizeof(int));
+    int *lpos = (int *)malloc((atoms+1)*sizeof(int));
+
+    if(!stack || !rpos || !lpos)
+      failure(ERROR_MEMORY, "out of memory!");
+
+    /* Roots are taken in the order of first occurrence */
+
+    for(scan=program; scan; scan=scan->next)
+      for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+	int *atoms = NULL;
+	int cnt = occurring_atoms(scan, kind, &atoms);
+	int i = 0;
+
+	for(i=0; i<cnt; i++)
+	  if(numbers[atoms[i]] == -1)
+	    next = number_by_dependency(occurrences, atoms[i], numbers,
+					next, stack, rpos, lpos);
+      }
+
+    free(stack);
+    free(rpos);
+    free(lpos);
+    free_otab(occurrences);
+  }
+
+  /* The rest in the order of atom numbers */
+
+  for(atom=1; atom<=size; atom++)
+    if(numbers[atom] < 0)
+      numbers[atom] = ++next;
+
+  /* Rewrite literals and the table */
+
+  for(scan=program; scan; scan=scan->next)
+    for(kind=OCC_HEAD; kind<=OCC_NEG; kind++) {
+      int *atoms = NULL;
+      int cnt = occurring_atoms(scan, kind, &atoms);
+
+      while(cnt--)
+	atoms[cnt] = numbers[atoms[cnt]];
+    }
+
+  if(table)
+    table = renumber_table(table, next, size, numbers);
+
+  free(numbers);
+
+  return table;
+}
@@ -0,0 +1,741 @@
+/* liblp -- ASPTOOLS library for the Smodels file format
+
+   Copyright (C) 2022 Tomi Janhunen
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+   USA
+*/
+
+/*
+ * Binary snapshots of programs and their symbol tables
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define MAPPED_INPUT 1
+#endif
+
+#include "version.h"
+#include "symbol.h"
+#include "atom.h"
+#include "rule.h"
+#include "io.h"
+#include "snapshot.h"
+#include "thread.h"
+#include "context.h"
+
+/* --------------------- Print version information ------------------------- */
+
+void _version_snapshot_h()
+{
+  _version(_SNAPSHOT_H_RCSFILE, _SNAPSHOT_H_DATE, _SNAPSHOT_H_REVISION);
+}
+
+void _version_snapshot_c()
+{
+  _version_snapshot_h();
+  _version("$RCSfile: snapshot.c,v $",
+	   "$Date: 2023/04/10 10:00:00 $",
+	   "$Revision: 1.1 $");
+}
+
+/* ------------------------------- Format ---------------------------------- */
+
+/* A snapshot consists of a header, the following sections (each padded
+   to a multiple of 8 bytes), and a checksum of everything before it:
+
+     types                                          int[rules]
+     starts                                         long[rules]
+     head_cnts, neg_cnts, pos_cnts                  int[rules] each
+     bounds                                         long[rules]
+     pool                                           int[used]
+     pieces                                         PIECE[pieces]
+     names                                          int64_t[atoms]
+     statuses                                       int[atoms]
+     strings                                        char[names]
+
+   The entries 0..count of each piece are stored in turn (atoms in all)
+   and names gives the offset of each name in strings (or -1).  Thus the
+   rules can be used in place and the table is filled by copying. */
+
+#define SNAPSHOT_MAGIC "LPSNAPSH"
+#define ORDER_MARK 0x01020304
+#define SIZES ((uint32_t)(sizeof(int) | sizeof(long) << 8))
+#define PAD(n) (((n)+7) & ~(int64_t)7)
+
+typedef struct header {
+  char magic[8];        /* SNAPSHOT_MAGIC */
+  uint32_t version;     /* SNAPSHOT_VERSION */
+  uint32_t order;       /* ORDER_MARK in the byte order of the writer */
+  uint32_t sizes;       /* Sizes of int and long of the writer */
+  int32_t number;       /* Number of models */
+  int64_t size;         /* Size of the snapshot in bytes */
+  int64_t rules;        /* Number of rules */
+  int64_t used;         /* Literals and weights in the pool */
+  int64_t pieces;       /* Pieces of the atom table */
+  int64_t atoms;        /* Entries of the pieces */
+  int64_t names;        /* Bytes in strings */
+  int64_t max_atom;     /* Largest atom number and weight read */
+  int64_t max_weight;
+} HEADER;
+
+typedef struct piece {
+  int32_t count;
+  int32_t offset;
+  int32_t shift;
+  int32_t unused;
+} PIECE;
+
+/* Size of a snapshot (or -1 if the counts are out of range) */
+
+int64_t snapshot_size(HEADER *header)
+{
+  int64_t rules = header->rules;
+  int64_t used = header->used;
+  int64_t atoms = header->atoms;
+
+  if(rules < 0 || rules > ((int64_t)1 << 40) ||
+     used < 0 || used > ((int64_t)1 << 40) ||
+     header->pieces < 0 || header->pieces > INT_MAX ||
+     atoms < header->pieces || atoms > ((int64_t)1 << 40) ||
+     header->names < 0 || header->names > ((int64_t)1 << 50))
+    return -1;
+
+  return (int64_t)sizeof(HEADER)
+    + 4*PAD(rules*(int64_t)sizeof(int))
+    + 2*PAD(rules*(int64_t)sizeof(long))
+    + PAD(used*(int64_t)sizeof(int))
+    + header->pieces*(int64_t)sizeof(PIECE)
+    + atoms*(int64_t)sizeof(int64_t)
+    + PAD(atoms*(int64_t)sizeof(int))
+    + PAD(header->names)
+    + (int64_t)sizeof(uint64_t);
+}
+
+/* ------------------------------ Checksums -------------------------------- */
+
+/* The checksum combines the checksums of blocks of BLOCK bytes so that
+   the blocks can be checked in parallel; each block is processed eight
+   bytes at a time in four independent lanes */
+
+#define BLOCK (1<<20)
+#define SEED 0x9e3779b97f4a7c15ULL
+
+#define MIX(h) ((h) ^= (h) >> 32, (h) *= 0xd6e8feb86659fd93ULL, \
+		(h) ^= (h) >> 32)
+#define ROUND(h, w) ((h) ^= (w), (h) *= 0x9e3779b185ebca87ULL, \
+		     (h) = (h) << 31 | (h) >> 33)
+
+uint64_t checksum_block(char *data, long len)  /* len is a multiple of 8 */
+{
+  uint64_t h[4];
+  uint64_t w[4];
+  uint64_t sum = 0;
+  long i = 0;
+
+  for(i=0; i<4; i++)
+    h[i] = (SEED + (uint64_t)i) ^ (uint64_t)len;
+
+  for(i=0; i+32 <= len; i += 32) {
+    memcpy(w, &data[i], 32);
+    ROUND(h[0], w[0]);
+    ROUND(h[1], w[1]);
+    ROUND(h[2], w[2]);
+    ROUND(h[3], w[3]);
+  }
+  for(; i < len; i += 8) {
+    memcpy(w, &data[i], 8);
+    ROUND(h[0], w[0]);
+  }
+
+  sum = h[0];
+  for(i=1; i<4; i++) {
+    MIX(sum);
+    sum ^= h[i];
+  }
+  MIX(sum);
+
+  return sum;
+}
+
+uint64_t combine_checksums(uint64_t sum, uint64_t block)
+{
+  sum ^= block;
+  MIX(sum);
+
+  return sum;
+}
+
+/* ------------------------------- Writing --------------------------------- */
+
+/* Data is gathered in blocks which are summed as they are written */
+
+typedef struct swriter {
+  FILE *out;
+  char *buf;
+  long fill;            /* Bytes in buf */
+  int64_t written;      /* Bytes put so far */
+  uint64_t sum;         /* Checksum of the blocks written */
+} SWRITER;
+
+void flush_block(SWRITER *w)
+{
+  if(w->fill) {
+    w->sum = combine_checksums(w->sum, checksum_block(w->buf, w->fill));
+    fwrite(w->buf, 1, w->fill, w->out);
+    w->fill = 0;
+  }
+
+  return;
+}
+
+void put_bytes(SWRITER *w, void *data, int64_t len)
+{
+  char *from = (char *)data;
+
+  while(len > 0) {
+    long room = BLOCK - w->fill;
+    long n = len < room ? (long)len : room;
+
+    memcpy(&w->buf[w->fill], from, n);
+    w->fill += n;
+    w->written += n;
+    from += n;
+    len -= n;
+    if(w->fill == BLOCK)
+      flush_block(w);
+  }
+
+  return;
+}
+
+void put_section(SWRITER *w, void *data, int64_t len)
+{
+  char zeros[8];
+
+  memset(zeros, 0, 8);
+  put_bytes(w, data, len);
+  put_bytes(w, zeros, PAD(w->written) - w->written);
+
+  return;
+}
+
+char *symbol_name(SYMBOL *symbol)
+{
+  return symbol ? symbol->name : NULL;
+}
+
+void write_snapshot_rtab(FILE *out, RTAB *rules, ATAB *table, int number)
+{
+  HEADER header;
+  PIECE piece;
+  SWRITER w;
+  ATAB *scan = NULL;
+  int64_t offset = 0;
+  int64_t none = -1;
+  long count = rules ? rules->count : 0;
+  int i = 0;
+
+  memset(&header, 0, sizeof(HEADER));
+  memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+  header.version = SNAPSHOT_VERSION;
+  header.order = ORDER_MARK;
+  header.sizes = SIZES;
+  header.number = number;
+  header.rules = count;
+  header.used = rules ? rules->used : 0;
+  header.max_atom = current_context->max_atom;
+  header.max_weight = current_context->max_weight;
+
+  for(scan = table; scan; scan = scan->next) {
+    header.pieces++;
+    header.atoms += scan->count+1;
+    for(i=1; i<=scan->count; i++)
+      if(symbol_name(scan->names[i]))
+	header.names += strlen(scan->names[i]->name)+1;
+  }
+
+  if((header.size = snapshot_size(&header)) < 0)
+    failure(ERROR_UNSUPPORTED, "the table is too large for a snapshot");
+
+  w.out = out;
+  w.fill = 0;
+  w.written = 0;
+  w.sum = SEED;
+  if((w.buf = (char *)malloc(BLOCK)) == NULL)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  put_bytes(&w, &header, sizeof(HEADER));
+
+  if(rules) {
+    put_section(&w, rules->types, (int64_t)count*sizeof(int));
+    put_section(&w, rules->starts, (int64_t)count*sizeof(long));
+    put_section(&w, rules->head_cnts, (int64_t)count*sizeof(int));
+    put_section(&w, rules->neg_cnts, (int64_t)count*sizeof(int));
+    put_section(&w, rules->pos_cnts, (int64_t)count*sizeof(int));
+    put_section(&w, rules->bounds, (int64_t)count*sizeof(long));
+    put_section(&w, rules->pool, (int64_t)rules->used*sizeof(int));
+  }
+
+  for(scan = table; scan; scan = scan->next) {
+    piece.count = scan->count;
+    piece.offset = scan->offset;
+    piece.shift = scan->shift;
+    piece.unused = 0;
+    put_bytes(&w, &piece, sizeof(PIECE));
+  }
+
+  for(scan = table; scan; scan = scan->next) {
+    put_bytes(&w, &none, sizeof(int64_t));
+    for(i=1; i<=scan->count; i++)
+      if(symbol_name(scan->names[i])) {
+	put_bytes(&w, &offset, sizeof(int64_t));
+	offset += strlen(scan->names[i]->name)+1;
+      } else
+	put_bytes(&w, &none, sizeof(int64_t));
+  }
+
+  for(scan = table; scan; scan = scan->next)
+    for(i=0; i<=scan->count; i++) {
+      int status = get_piece_status(scan, i);
+
+      put_bytes(&w, &status, sizeof(int));
+    }
+  put_section(&w, NULL, 0);
+
+  for(scan = table; scan; scan = scan->next)
+    for(i=1; i<=scan->count; i++)
+      if(symbol_name(scan->names[i]))
+	put_bytes(&w, scan->names[i]->name, strlen(scan->names[i]->name)+1);
+  put_section(&w, NULL, 0);
+
+  flush_block(&w);
+  fwrite(&w.sum, sizeof(uint64_t), 1, out);
+  free(w.buf);
+
+  if(ferror(out))
+    failure(ERROR_FAILED, "cannot write the snapshot");
+
+  return;
+}
+
+void write_snapshot(FILE *out, RULE *program, ATAB *table, int number)
+{
+  RTAB *rules = program_to_rtab(program);
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int failed = 0;
+
+  if(setjmp(abort) == 0)
+    write_snapshot_rtab(out, rules, table, number);
+  else
+    failed = -1;
+  (void) catch_errors(previous);
+
+  free_rtab(rules);
+  if(failed)
+    raise_failure();
+
+  return;
+}
+
+/* ------------------------------- Loading --------------------------------- */
+
+void free_snapshot(SNAPSHOT *snapshot)
+{
+  if(snapshot->map) {
+#ifdef MAPPED_INPUT
+    munmap(snapshot->map, snapshot->map_size);
+#endif
+  } else
+    free(snapshot->data);
+  free(snapshot);
+
+  return;
+}
+
+NORETURN void reject_snapshot(SNAPSHOT *snapshot, int code, char *msg)
+{
+  free_snapshot(snapshot);
+  failure(code, "%s", msg);
+}
+
+/* Map the snapshot if it lies in a regular file suitably aligned, and
+   read it to memory otherwise; the header has been read already */
+
+void load_data(SNAPSHOT *snapshot, HEADER *header, FILE *in, long start)
+{
+#ifdef MAPPED_INPUT
+  struct stat info;
+  char *map = NULL;
+
+  if(start >= 0 && start % 8 == 0 &&
+     fstat(fileno(in), &info) == 0 && S_ISREG(info.st_mode) &&
+     start + snapshot->size <= info.st_size) {
+    map = (char *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+		       fileno(in), 0);
+    if(map != MAP_FAILED) {
+      snapshot->map = map;
+      snapshot->map_size = info.st_size;
+      snapshot->data = &map[start];
+      fseek(in, start + snapshot->size, SEEK_SET);
+      return;
+    }
+  }
+#endif
+
+  if((snapshot->data = (char *)malloc(snapshot->size)) == NULL)
+    reject_snapshot(snapshot, ERROR_MEMORY, "out of memory!");
+  memcpy(snapshot->data, header, sizeof(HEADER));
+  if(fread(&snapshot->data[sizeof(HEADER)], 1,
+	   snapshot->size - sizeof(HEADER), in)
+     != (size_t)(snapshot->size - sizeof(HEADER)))
+    reject_snapshot(snapshot, ERROR_SYNTAX, "truncated snapshot");
+
+  return;
+}
+
+typedef struct cjob {
+  char *data;
+  long length;          /* Bytes covered by the checksum */
+  uint64_t *sums;       /* Checksums of blocks */
+} CJOB;
+
+void checksum_range(void *data, int index)
+{
+  CJOB *job = (CJOB *)data;
+  long first = (long)index*BLOCK;
+  long len = job->length - first;
+
+  job->sums[index] = checksum_block(&job->data[first],
+				    len < BLOCK ? len : BLOCK);
+
+  return;
+}
+
+int verify_checksum(SNAPSHOT *snapshot)
+{
+  CJOB job;
+  uint64_t sum = SEED;
+  uint64_t stored = 0;
+  int blocks = 0;
+  int i = 0;
+
+  job.data = snapshot->data;
+  job.length = snapshot->size - sizeof(uint64_t);
+  blocks = (int)((job.length + BLOCK - 1)/BLOCK);
+  if((job.sums = (uint64_t *)malloc(blocks * sizeof(uint64_t))) == NULL)
+    reject_snapshot(snapshot, ERROR_MEMORY, "out of memory!");
+
+  if(worker_threads > 1 && blocks > 1)
+    run_parallel(blocks, checksum_range, &job);
+  else
+    for(i=0; i<blocks; i++)
+      checksum_range(&job, i);
+
+  for(i=0; i<blocks; i++)
+    sum = combine_checksums(sum, job.sums[i]);
+  free(job.sums);
+
+  memcpy(&stored, &snapshot->data[job.length], sizeof(uint64_t));
+
+  return sum == stored;
+}
+
+/* The rules are a view of the data: nothing is copied */
+
+char *view_rules(SNAPSHOT *snapshot, HEADER *header)
+{
+  RTAB *rules = &snapshot->rules;
+  char *at = &snapshot->data[sizeof(HEADER)];
+  int64_t count = header->rules;
+
+  rules->count = rules->size = (long)count;
+  rules->types = (int *)at;
+  at += PAD(count*(int64_t)sizeof(int));
+  rules->starts = (long *)at;
+  at += PAD(count*(int64_t)sizeof(long));
+  rules->head_cnts = (int *)at;
+  at += PAD(count*(int64_t)sizeof(int));
+  rules->neg_cnts = (int *)at;
+  at += PAD(count*(int64_t)sizeof(int));
+  rules->pos_cnts = (int *)at;
+  at += PAD(count*(int64_t)sizeof(int));
+  rules->bounds = (long *)at;
+  at += PAD(count*(int64_t)sizeof(long));
+  rules->used = rules->pool_size = (long)header->used;
+  rules->pool = (int *)at;
+  at += PAD(header->used*(int64_t)sizeof(int));
+
+  return at;
+}
+
+/* The rules are checked to lie within the pool whether the checksum is
+   verified or not; this takes time linear in the number of rules */
+
+int check_rules(RTAB *rules)
+{
+  long i = 0;
+
+  for(i=0; i<rules->count; i++) {
+    long head_cnt = (rules->head_cnts)[i];
+    long neg_cnt = (rules->neg_cnts)[i];
+    long pos_cnt = (rules->pos_cnts)[i];
+    long lits = head_cnt+neg_cnt+pos_cnt;
+
+    if(head_cnt < 0 || neg_cnt < 0 || pos_cnt < 0)
+      return 0;
+
+    switch((rules->types)[i]) {
+    case TYPE_BASIC:
+    case TYPE_CONSTRAINT:
+      if(head_cnt != 1)
+	return 0;
+      break;
+
+    case TYPE_WEIGHT:
+      if(head_cnt != 1)
+	return 0;
+      lits += neg_cnt+pos_cnt;
+      break;
+
+    case TYPE_OPTIMIZE:
+      if(head_cnt != 0)
+	return 0;
+      lits += neg_cnt+pos_cnt;
+      break;
+
+    case TYPE_INTEGRITY:
+    case TYPE_CLAUSE:
+      if(head_cnt != 0)
+	return 0;
+      break;
+
+    case TYPE_CHOICE:
+    case TYPE_DISJUNCTIVE:
+      break;
+
+    default:
+      return 0;
+    }
+
+    if((rules->starts)[i] < 0 || (rules->starts)[i] + lits > rules->used)
+      return 0;
+  }
+
+  return -1;
+}
+
+/* Names are interned in ranges of pieces; large pieces are split among
+   worker threads (cf. name_invisible_atoms) */
+
+#define LOAD_RANGE (1<<14)  /* Smallest range worth a job */
+
+typedef struct ljob {
+  ATAB *piece;
+  int64_t *names;       /* Offsets of the names of the piece */
+  char *strings;
+  int64_t size;         /* Bytes in strings */
+  int jobs;
+  int bad;              /* Offsets out of range were met */
+} LJOB;
+
+void load_names(void *data, int index)
+{
+  LJOB *job = (LJOB *)data;
+  ATAB *piece = job->piece;
+  int count = piece->count;
+  int first = 1 + (int)((long)count*index/job->jobs);
+  int last = (int)((long)count*(index+1)/job->jobs);
+  int i = 0;
+
+  for(i=first; i<=last; i++) {
+    int64_t at = job->names[i];
+
+    if(at >= 0 && at < job->size)
+      piece->names[i] = find_symbol(&job->strings[at]);
+    else if(at != -1)
+      ATOMIC_STORE(&job->bad, -1);
+  }
+
+  return;
+}
+
+int load_table(SNAPSHOT *snapshot, HEADER *header, char *at)
+{
+  PIECE *pieces = (PIECE *)at;
+  int64_t *names = (int64_t *)&pieces[header->pieces];
+  int *statuses = (int *)&names[header->atoms];
+  char *strings = (char *)statuses
+    + PAD(header->atoms*(int64_t)sizeof(int));
+  ATAB *piece = NULL;
+  int64_t atoms = 0;
+  LJOB job;
+  int i = 0;
+  int j = 0;
+
+  /* Check the pieces before building anything */
+
+  for(i=0; i<header->pieces; i++) {
+    if(pieces[i].count < 0 || pieces[i].offset < 0)
+      return 0;
+    atoms += pieces[i].count+1;
+  }
+  if(atoms != header->atoms ||
+     (header->names > 0 && strings[header->names-1] != '\0'))
+    return 0;
+
+  job.strings = strings;
+  job.size = header->names;
+  job.bad = 0;
+
+  for(i=0; i<header->pieces; i++) {
+    int count = pieces[i].count;
+
+    if(snapshot->table)
+      piece = extend_table(snapshot->table, count, pieces[i].offset);
+    else
+      piece = snapshot->table = new_table(count, pieces[i].offset);
+    piece->shift = pieces[i].shift;
+    for(j=1; j<=count; j++)
+      if(statuses[j])
+	set_piece_status(piece, j, statuses[j]);
+
+    job.piece = piece;
+    job.names = names;
+    job.jobs = 1;
+
+    if(worker_threads > 1 && count >= 2*LOAD_RANGE) {
+      int concurrent = concurrent_symbols(-1);
+
+      job.jobs = 4*worker_threads;
+      if(count/job.jobs < LOAD_RANGE)
+	job.jobs = count/LOAD_RANGE;
+      run_parallel(job.jobs, load_names, &job);
+      (void) concurrent_symbols(concurrent);
+    } else
+      load_names(&job, 0);
+
+    names += count+1;
+    statuses += count+1;
+  }
+
+  return !job.bad;
+}
+
+/* Load a snapshot written by write_snapshot from the current position
+   of the stream; the checksum is verified on request (which reads the
+   whole snapshot) while the layout of the rules and the table is always
+   checked (see check_rules and load_table) */
+
+SNAPSHOT *read_snapshot(FILE *in, int verify)
+{
+  SNAPSHOT *snapshot = (SNAPSHOT *)malloc(sizeof(SNAPSHOT));
+  long start = ftell(in);
+  HEADER header;
+  char *at = NULL;
+
+  if(!snapshot)
+    failure(ERROR_MEMORY, "out of memory!");
+
+  snapshot->data = NULL;
+  snapshot->size = 0;
+  snapshot->map = NULL;
+  snapshot->map_size = 0;
+  snapshot->table = NULL;
+  snapshot->number = 0;
+
+  if(fread(&header, sizeof(HEADER), 1, in) != 1 ||
+     memcmp(header.magic, SNAPSHOT_MAGIC, 8) != 0)
+    reject_snapshot(snapshot, ERROR_SYNTAX, "not a snapshot");
+  if(header.version != SNAPSHOT_VERSION)
+    reject_snapshot(snapshot, ERROR_UNSUPPORTED,
+		    "unsupported version of snapshot");
+  if(header.order != ORDER_MARK || header.sizes != SIZES)
+    reject_snapshot(snapshot, ERROR_UNSUPPORTED,
+		    "snapshot written on an incompatible machine");
+  if(header.size != snapshot_size(&header) || header.size > LONG_MAX)
+    reject_snapshot(snapshot, ERROR_SYNTAX, "corrupted snapshot");
+
+  snapshot->size = (long)header.size;
+  load_data(snapshot, &header, in, start);
+
+  if(verify && !verify_checksum(snapshot))
+    reject_snapshot(snapshot, ERROR_SYNTAX, "checksum mismatch in snapshot");
+
+  at = view_rules(snapshot, &header);
+  if(!check_rules(&snapshot->rules))
+    reject_snapshot(snapshot, ERROR_SYNTAX, "corrupted snapshot");
+  if(!load_table(snapshot, &header, at)) {
+    if(snapshot->table)
+      free_table(snapshot->table);
+    reject_snapshot(snapshot, ERROR_SYNTAX, "corrupted snapshot");
+  }
+  snapshot->number = header.number;
+
+  if(header.max_atom > current_context->max_atom)
+    current_context->max_atom = (int)header.max_atom;
+  if(header.max_weight > current_context->max_weight)
+    max_weight = current_context->max_weight = (long)header.max_weight;
+
+  return snapshot;
+}
+
+/* ---------------------- Variants returning a status ---------------------- */
+
+int write_snapshot_status(FILE *out, RULE *program, ATAB *table, int number)
+{
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  if(setjmp(abort) == 0)
+    write_snapshot(out, program, table, number);
+  else
+    code = current_context->error;
+  (void) catch_errors(previous);
+
+  return code;
+}
+
+int read_snapshot_status(FILE *in, int verify, SNAPSHOT **snapshot)
+{
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+  int code = ERROR_NONE;
+
+  *snapshot = NULL;
+
+  if(setjmp(abort) == 0)
+    *snapshot = read_snapshot(in, verify);
+  else
+    code = current_context->error;
+  (void) catch_errors(previous);
+
+  return code;
+}
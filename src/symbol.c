@@ -24,16 +24,90 @@
  * (c) 2006 Tomi Janhunen
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define MAPPED_INPUT 1
+#endif
 
 #include "version.h"
 #include "symbol.h"
+#include "thread.h"
+#include "context.h"
+
+#define HASH_SIZE   (1<<15)  /* Initial size (a power of two) */
+
+#define ARENA_SIZE  (1<<20)  /* Largest size of an arena block */
+
+/* The hash table is open-addressed (linear probing) and doubled when
+   half full; hash values are kept in the table to avoid strcmp calls
+   and rehashing */
+
+typedef struct slot {
+  uint64_t hash;       /* Hash value of the name */
+  SYMBOL *symbol;      /* NULL for a free slot */
+} SLOT;
+
+/* Symbols and their names are allocated from large blocks of memory
+   (arenas) owned by the symbol table; they are never freed one by one */
+
+typedef struct arena {
+  char *free;          /* Free space in this block */
+  char *end;           /* End of this block */
+  struct arena *next;  /* Previous (full) blocks */
+} ARENA;
+
+/* The table is divided into shards by the highest bits of hash values;
+   each shard is a hash table with a lock that is taken when several
+   threads may intern names at the same time (see concurrent_symbols),
+   and then new symbols come from an arena of the shard.  Equal names always
+   fall into the same shard and thus share a symbol regardless of the
+   thread interning them.  A single thread allocates all symbols from
+   one arena so that symbols created in a row stay close together. */
+
+#define SHARD_BITS  6
+#define SHARDS      (1<<SHARD_BITS)
+#define SHARD(h)    ((size_t)((h) >> (64-SHARD_BITS)))
+
+typedef struct pool {
+  ARENA *arena;        /* Current block */
+  int blocks;          /* Number of blocks allocated */
+} POOL;
+
+typedef struct shard {
+  SLOT *table;         /* Hash table */
+  size_t size;         /* Number of slots */
+  size_t count;        /* Number of symbols */
+  POOL pool;           /* Symbols created by concurrent callers */
+  LOCK *lock;          /* Taken by concurrent callers */
+} SHARD;
+
+/* Mapped input files that names of symbols point into are kept until
+   the table is freed (see find_shared_symbol and keep_mapping) */
 
-#define HASH_SIZE   32771  /* Prime */
+typedef struct mapping {
+  void *map;
+  size_t size;
+  struct mapping *next;
+} MAPPING;
 
-SYMBOL **symbol_table = NULL; /* Hash table */
+/* Each context has a symbol table of its own */
+
+typedef struct symbols {
+  SHARD shards[SHARDS];
+  POOL pool;           /* Symbols created by a single thread */
+  MAPPING *mappings;   /* Mappings shared with symbols */
+  int concurrent;      /* Several threads may intern at once */
+} SYMBOLS;
+
+LOCK *symbols_lock = NULL;  /* Guards the creation of tables */
 
 /*
  * _version_symbol_c -- print version information
@@ -48,8 +122,107 @@ void _version_symbol_c()
 {
   _version_symbol_h();
   _version("$RCSfile: symbol.c,v $",
-	   "$Date: 2021/05/27 07:55:48 $",
-	   "$Revision: 1.5 $");
+	   "$Date: 2023/04/03 10:00:00 $",
+	   "$Revision: 1.6 $");
+}
+
+/*
+ * new_symbols -- Create an empty symbol table (NULL if out of memory)
+ */
+
+SYMBOLS *new_symbols()
+{
+  SYMBOLS *symbols = (SYMBOLS *)malloc(sizeof(SYMBOLS));
+  int failed = !symbols;
+  int i = 0;
+
+  if(symbols) {
+    symbols->pool.arena = NULL;
+    symbols->pool.blocks = 0;
+    symbols->mappings = NULL;
+    symbols->concurrent = 0;
+  }
+
+  for(i=0; !failed && i<SHARDS; i++) {
+    SHARD *shard = &(symbols->shards)[i];
+
+    shard->size = HASH_SIZE/SHARDS;
+    shard->count = 0;
+    shard->pool.arena = NULL;
+    shard->pool.blocks = 0;
+    shard->table = (SLOT *)calloc(shard->size, sizeof(SLOT));
+    shard->lock = new_lock();
+    failed = !shard->table || !shard->lock;
+  }
+
+  if(failed)
+    failure(ERROR_MEMORY, "symbol table: out of memory");
+
+  return symbols;
+}
+
+void free_pool(POOL *pool)
+{
+  while(pool->arena) {
+    ARENA *next = pool->arena->next;
+
+    free(pool->arena);
+    pool->arena = next;
+  }
+
+  return;
+}
+
+void free_symbols(SYMBOLS *symbols)
+{
+  int i = 0;
+
+  for(i=0; i<SHARDS; i++) {
+    SHARD *shard = &(symbols->shards)[i];
+
+    free_pool(&shard->pool);
+    free(shard->table);
+    free_lock(shard->lock);
+  }
+  free_pool(&symbols->pool);
+
+  while(symbols->mappings) {
+    MAPPING *next = symbols->mappings->next;
+
+#ifdef MAPPED_INPUT
+    munmap(symbols->mappings->map, symbols->mappings->size);
+#endif
+    free(symbols->mappings);
+    symbols->mappings = next;
+  }
+  free(symbols);
+
+  return;
+}
+
+/*
+ * get_symbols -- Symbol table of the current context (created if needed)
+ */
+
+SYMBOLS *get_symbols()
+{
+  SYMBOLS *symbols = ATOMIC_LOAD(&(current_context->symbols));
+
+  if(!symbols) {
+    SYMBOLS *new = new_symbols();
+
+    acquire(lock_once(&symbols_lock));
+    if((symbols = current_context->symbols) == NULL) {
+      symbols = new;
+      ATOMIC_STORE(&(current_context->symbols), new);
+    }
+    release(symbols_lock);
+
+    if(symbols != new)  /* Created by another thread meanwhile */
+      free_symbols(new);
+  }
+
+  return symbols;
 }
 
 /*
@@ -58,28 +231,190 @@ void _version_symbol_c()
 
 void symbol_table_init()
 {
-  if(!symbol_table) {
-    int i=0;
-    symbol_table = (SYMBOL **)malloc(sizeof(SYMBOL *)*HASH_SIZE);
+  (void) get_symbols();
+
+  return;
+}
+
+/*
+ * concurrent_symbols -- Set the mode of interning for the symbol table
+ *                       of the current context (the previous mode is
+ *                       returned)
+ */
+
+int concurrent_symbols(int mode)
+{
+  SYMBOLS *symbols = get_symbols();
+  int previous = symbols->concurrent;
+
+  symbols->concurrent = mode;
 
-    for(i=0; i<HASH_SIZE; i++)
-      symbol_table[i] = NULL;
+  return previous;
+}
+
+/*
+ * lock_shard, unlock_shard -- Exclude other threads from a shard if
+ *                             interning is concurrent
+ */
+
+SHARD *lock_shard(SYMBOLS *symbols, uint64_t h)
+{
+  SHARD *shard = &(symbols->shards)[SHARD(h)];
+
+  if(symbols->concurrent)
+    acquire(shard->lock);
+
+  return shard;
+}
+
+void unlock_shard(SYMBOLS *symbols, SHARD *shard)
+{
+  if(symbols->concurrent)
+    release(shard->lock);
+
+  return;
+}
+
+/*
+ * symbol_alloc -- Allocate space for symbols from a pool; blocks grow up
+ *                 to ARENA_SIZE (NULL if out of memory)
+ */
+
+void *symbol_alloc(POOL *pool, int size)
+{
+  ARENA *arena = pool->arena;
+  char *space = NULL;
+
+  /* Keep symbols aligned */
+
+  size = (size + sizeof(void *)-1) & ~(int)(sizeof(void *)-1);
+
+  if(!arena || arena->end - arena->free < size) {
+    int block = ARENA_SIZE;
+    int own = 0;
+
+    if(pool->blocks < SHARD_BITS)  /* Small tables stay small */
+      block = (ARENA_SIZE/SHARDS) << pool->blocks;
+
+    if((own = (size > block/4)))  /* A block of its own */
+      block = size + sizeof(ARENA);
+
+    arena = (ARENA *)malloc(block);
+    if(!arena)
+      return NULL;
+    arena->free = (char *)arena + sizeof(ARENA);
+    arena->end = (char *)arena + block;
+    pool->blocks++;
+
+    if(pool->arena && own) {
+      /* Do not waste the current block */
+      arena->next = pool->arena->next;
+      pool->arena->next = arena;
+    } else {
+      arena->next = pool->arena;
+      pool->arena = arena;
+    }
   }
 
+  space = arena->free;
+  arena->free += size;
+
+  return (void *)space;
+}
+
+/*
+ * symbol_table_free -- Free the symbol table and all symbols at once
+ *                      (including the mappings they point into)
+ */
+
+void symbol_table_free()
+{
+  SYMBOLS *symbols = current_context->symbols;
+
+  if(!symbols)
+    return;
+
+  free_symbols(symbols);
+  current_context->symbols = NULL;
+
   return;
 }
 
 /*
- * make_symbol -- Allocate entry for a new symbol
+ * keep_mapping -- Hand a mapping that names of symbols point into over
+ *                 to the symbol table (unmapped by symbol_table_free)
  */
 
-SYMBOL *make_symbol(char *name)
+void keep_mapping(void *map, size_t size)
+{
+  SYMBOLS *symbols = get_symbols();
+  MAPPING *mapping = (MAPPING *)malloc(sizeof(MAPPING));
+
+  if(!mapping)
+    failure(ERROR_MEMORY, "symbol table: out of memory");
+
+  mapping->map = map;
+  mapping->size = size;
+
+  acquire(lock_once(&symbols_lock));
+  mapping->next = symbols->mappings;
+  symbols->mappings = mapping;
+  release(symbols_lock);
+
+  return;
+}
+
+/*
+ * hash -- Calculate a 64-bit hash value for a string (eight characters
+ *         at a time)
+ */
+
+#define HASH_MIX(h) ((h) ^= (h) >> 32, (h) *= 0xd6e8feb86659fd93ULL, \
+		     (h) ^= (h) >> 32)
+
+uint64_t hash(char *name, size_t len)
+{
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+  uint64_t word = 0;
+
+  for(; len >= 8; name += 8, len -= 8) {
+    memcpy(&word, name, 8);
+    h ^= word;
+    HASH_MIX(h);
+  }
+
+  word = 0;
+  memcpy(&word, name, len);
+  h ^= word;
+  HASH_MIX(h);
+
+  return h;
+}
+
+/*
+ * new_symbol -- Allocate entry for a new symbol in a shard; the name is
+ *               copied unless it is shared (NULL if out of memory)
+ */
+
+SYMBOL *new_symbol(POOL *pool, char *name, int shared)
 {
-  SYMBOL *s = (SYMBOL *)malloc(sizeof(struct symbol));
   int len = strlen(name)+1;
+  SYMBOL *s = (SYMBOL *)symbol_alloc(pool, sizeof(struct symbol) +
+				     (shared ? 0 : len));
+
+  if(!s)
+    return NULL;
 
-  s->name = (char *)malloc(len);
-  strncpy(s->name, name, len);
+  /* The name is stored right after the entry */
+
+  if(shared)
+    s->name = name;
+  else {
+    s->name = (char *)&s[1];
+    memcpy(s->name, name, len);
+  }
+  s->length = len-1;
+  s->split = strcspn(name, "(");
   s->info.atom = 0;
   s->info.table = NULL;
   s->info.module = 0;
@@ -89,22 +424,103 @@ SYMBOL *make_symbol(char *name)
 }
 
 /*
- * hash -- Calculate a hash value for a string (a la P. J. Weinberger)
+ * make_symbol -- Allocate entry for a new symbol
+ */
+
+SYMBOL *make_symbol(char *name)
+{
+  SYMBOLS *symbols = get_symbols();
+  SHARD *shard = lock_shard(symbols, hash(name, strlen(name)));
+  SYMBOL *s = new_symbol(symbols->concurrent ? &shard->pool : &symbols->pool,
+			 name, 0);
+
+  unlock_shard(symbols, shard);
+  if(!s)
+    failure(ERROR_MEMORY, "symbol table: out of memory");
+
+  return s;
+}
+
+/*
+ * grow_shard -- Double the size of the hash table of a shard (zero if
+ *               out of memory)
+ */
+
+int grow_shard(SHARD *shard)
+{
+  SLOT *old = shard->table;
+  size_t old_size = shard->size;
+  size_t mask = 2*old_size-1;
+  SLOT *table = (SLOT *)calloc(2*old_size, sizeof(SLOT));
+  size_t i = 0;
+
+  if(!table)
+    return 0;
+
+  for(i=0; i<old_size; i++)
+    if(old[i].symbol) {
+      size_t j = old[i].hash & mask;
+
+      while(table[j].symbol)
+	j = (j+1) & mask;
+      table[j] = old[i];
+    }
+
+  shard->size = 2*old_size;
+  shard->table = table;
+  free(old);
+
+  return -1;
+}
+
+/*
+ * lookup_symbol -- Locate the slot of a name (or a free slot where to
+ *                  insert it)
+ */
+
+SLOT *lookup_symbol(SHARD *shard, char *name, uint64_t h)
+{
+  size_t mask = shard->size-1;
+  size_t i = h & mask;
+  SLOT *slot = NULL;
+
+  for(;;) {
+    slot = &(shard->table)[i];
+    if(!slot->symbol ||
+       (slot->hash == h && strcmp(slot->symbol->name, name) == 0))
+      return slot;
+    i = (i+1) & mask;
+  }
+}
+
+/*
+ * intern -- Fetch the entry for the identifier from a shard or insert a
+ *           new one (NULL if out of memory)
  */
 
-int hash(char *name)
+SYMBOL *intern(SYMBOLS *symbols, SHARD *shard, char *name, uint64_t h,
+	       int shared)
 {
-  char *scan;
-  unsigned int h = 0, g;
+  SLOT *slot = lookup_symbol(shard, name, h);
+
+  if(slot->symbol == NULL) {
+    POOL *pool = symbols->concurrent ? &shard->pool : &symbols->pool;
+    SYMBOL *new = new_symbol(pool, name, shared);
+
+    if(!new)
+      return NULL;
 
-  for (scan = name; *scan; scan++) {
-    h = (h << 4) + *scan;
-    if (g = h&0xf0000000) {
-      h ^= g >> 24;
-      h ^= g;
+    if(2*(shard->count+1) > shard->size) {
+      if(!grow_shard(shard))
+	return NULL;
+      slot = lookup_symbol(shard, name, h);
     }
+    shard->count++;
+    slot->hash = h;
+    slot->symbol = new;
   }
-  return h % HASH_SIZE;
+
+  return slot->symbol;
 }
 
 /*
@@ -113,19 +529,58 @@ int hash(char *name)
 
 SYMBOL *find_symbol(char *name)
 {
-  int hval = hash(name);
-  SYMBOL *scan = symbol_table[hval];
+  uint64_t h = hash(name, strlen(name));
+  SYMBOLS *symbols = get_symbols();
+  SHARD *shard = lock_shard(symbols, h);
+  SYMBOL *symbol = intern(symbols, shard, name, h, 0);
 
-  while (scan && strcmp(scan->name, name) != 0)
-    scan = scan->next;
+  unlock_shard(symbols, shard);
+  if(!symbol)
+    failure(ERROR_MEMORY, "symbol table: out of memory");
 
-  if (scan == NULL) {
-    scan = make_symbol(name);
-    scan->next = symbol_table[hval];
-    symbol_table[hval] = scan;
-  }
+  return symbol;
+}
 
-  return scan;
+/*
+ * lookup_name -- Fetch the entry for the identifier if there is one
+ */
+
+SYMBOL *lookup_name(char *name)
+{
+  SYMBOLS *symbols = ATOMIC_LOAD(&(current_context->symbols));
+  uint64_t h = 0;
+  SHARD *shard = NULL;
+  SYMBOL *symbol = NULL;
+
+  if(!symbols)
+    return NULL;
+
+  h = hash(name, strlen(name));
+  shard = lock_shard(symbols, h);
+  symbol = lookup_symbol(shard, name, h)->symbol;
+  unlock_shard(symbols, shard);
+
+  return symbol;
+}
+
+/*
+ * find_shared_symbol -- As find_symbol but a new entry refers to the
+ *                       string itself (which must not be freed) rather
+ *                       than to a copy of it
+ */
+
+SYMBOL *find_shared_symbol(char *name)
+{
+  uint64_t h = hash(name, strlen(name));
+  SYMBOLS *symbols = get_symbols();
+  SHARD *shard = lock_shard(symbols, h);
+  SYMBOL *symbol = intern(symbols, shard, name, h, -1);
+
+  unlock_shard(symbols, shard);
+  if(!symbol)
+    failure(ERROR_MEMORY, "symbol table: out of memory");
+
+  return symbol;
 }
 
 /*
@@ -136,3 +591,17 @@ void print_symbol(FILE *out, SYMBOL *s)
 {
   fprintf(out, "%s", s->name);
 }
+
+/*
+ * find_symbol_ctx -- As find_symbol but in the given context
+ */
+
+SYMBOL *find_symbol_ctx(struct context *context, char *name)
+{
+  CONTEXT *previous = use_context(context);
+  SYMBOL *symbol = find_symbol(name);
+
+  (void) use_context(previous);
+
+  return symbol;
+}
@@ -0,0 +1,257 @@
+/* liblp -- ASPTOOLS library for the Smodels file format
+
+   Copyright (C) 2022 Tomi Janhunen
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+   USA
+*/
+
+/*
+ * A simple pool of worker threads for data parallel tasks
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "version.h"
+#include "thread.h"
+#include "context.h"
+
+int worker_threads = 1;
+
+/* --------------------- Print version information ------------------------- */
+
+void _version_thread_h()
+{
+  _version(_THREAD_H_RCSFILE, _THREAD_H_DATE, _THREAD_H_REVISION);
+}
+
+void _version_thread_c()
+{
+  _version_thread_h();
+  _version("$RCSfile: thread.c,v $",
+	   "$Date: 2023/03/10 10:12:41 $",
+	   "$Revision: 1.1 $");
+}
+
+/* ------------------------- Run jobs in parallel -------------------------- */
+
+typedef struct pool {
+  int jobs;                      /* Number of jobs */
+  int next;                      /* Next job to be taken */
+  void (*job)(void *, int);      /* Job to be run */
+  void *data;                    /* Data shared by the jobs */
+  CONTEXT *context;              /* Context of the caller */
+  int failed;                    /* Some job has failed */
+  CONTEXT failure;               /* The first failure of a job */
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t lock;          /* Protects next and the above */
+#endif
+} POOL;
+
+/* Failures of jobs are caught and recorded by each thread apart; only
+   the first one is kept and no further jobs are started after it */
+
+THREAD_LOCAL CONTEXT job_failure;
+
+void copy_failure(CONTEXT *to, CONTEXT *from)
+{
+  to->error = from->error;
+  to->offset = from->offset;
+  to->line = from->line;
+  memcpy(to->message, from->message, ERROR_SIZE);
+
+  return;
+}
+
+void *run_jobs(void *arg)
+{
+  POOL *pool = (POOL *)arg;
+  CONTEXT *record = record_failures(&job_failure);
+  jmp_buf abort;
+  jmp_buf *previous = catch_errors(&abort);
+
+  (void) use_context(pool->context);
+
+  for(;;) {
+    int index = 0;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&pool->lock);
+#endif
+    index = pool->failed ? pool->jobs : (pool->next)++;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&pool->lock);
+#endif
+
+    if(index >= pool->jobs)
+      break;
+
+    if(setjmp(abort) == 0)
+      (pool->job)(pool->data, index);
+    else {
+#ifdef HAVE_PTHREAD
+      pthread_mutex_lock(&pool->lock);
+#endif
+      if(!pool->failed) {
+	pool->failed = -1;
+	copy_failure(&pool->failure, &job_failure);
+      }
+#ifdef HAVE_PTHREAD
+      pthread_mutex_unlock(&pool->lock);
+#endif
+    }
+  }
+
+  (void) catch_errors(previous);
+  (void) record_failures(record);
+
+  return NULL;
+}
+
+/* Run job(data, 0), ..., job(data, jobs-1) using worker_threads threads
+   (including the calling one); the jobs must be independent.  The first
+   failure of a job is raised in the calling thread after all threads
+   have finished. */
+
+void run_parallel(int jobs, void (*job)(void *data, int index), void *data)
+{
+  POOL pool;
+  int threads = worker_threads < jobs ? worker_threads : jobs;
+
+  pool.jobs = jobs;
+  pool.next = 0;
+  pool.job = job;
+  pool.data = data;
+  pool.context = current_context;
+  pool.failed = 0;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_init(&pool.lock, NULL);  /* Taken by run_jobs in any case */
+
+  if(threads > 1) {
+    pthread_t *workers = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    int i = 0;
+
+    for(i=1; i<threads; i++)
+      if(pthread_create(&workers[started], NULL, run_jobs, &pool) == 0)
+	started++;
+
+    (void) run_jobs(&pool);
+
+    for(i=0; i<started; i++)
+      pthread_join(workers[i], NULL);
+
+    free(workers);
+  } else
+    (void) run_jobs(&pool);
+
+  pthread_mutex_destroy(&pool.lock);
+#else
+  (void) run_jobs(&pool);
+#endif
+
+  if(pool.failed) {
+    copy_failure(current_context, &pool.failure);
+    raise_failure();
+  }
+
+  return;
+}
+
+/* ----------------------------- Simple locks ------------------------------ */
+
+struct lock {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t mutex;
+#else
+  int unused;
+#endif
+};
+
+LOCK *new_lock()
+{
+  LOCK *lock = (LOCK *)malloc(sizeof(LOCK));
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_init(&lock->mutex, NULL);
+#endif
+
+  return lock;
+}
+
+void acquire(LOCK *lock)
+{
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&lock->mutex);
+#else
+  (void) lock;
+#endif
+
+  return;
+}
+
+void release(LOCK *lock)
+{
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&lock->mutex);
+#else
+  (void) lock;
+#endif
+
+  return;
+}
+
+#ifdef HAVE_PTHREAD
+pthread_mutex_t lock_guard = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Create a lock on first use (even if several threads race for it) */
+
+LOCK *lock_once(LOCK **lock)
+{
+  LOCK *result = NULL;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&lock_guard);
+#endif
+  if(!*lock)
+    *lock = new_lock();
+  result = *lock;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&lock_guard);
+#endif
+
+  return result;
+}
+
+void free_lock(LOCK *lock)
+{
+#ifdef HAVE_PTHREAD
+  pthread_mutex_destroy(&lock->mutex);
+#endif
+  free(lock);
+
+  return;
+}
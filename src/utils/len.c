@@ -79,6 +79,7 @@ int main(int argc, char **argv)
   char *file = NULL;
   FILE *in = NULL;
   RULE *rule = NULL, *cnf = NULL, *clause = NULL;
+  RULE_ARENA *buffer = new_rule_arena();  /* Reused for every rule */
   ATAB *table = NULL;
   int i = 0;
   int rcnt = 0;
@@ -163,6 +164,8 @@ int main(int argc, char **argv)
       exit(-1);
     }
   }
+
+  (void) map_input(in);  /* Parse regular files in place */
   
   if(option_dimacs) {
     int clauses = 0;
@@ -173,15 +176,14 @@ int main(int argc, char **argv)
 
     /* Read clauses in one by one and make calculations */
     while(clauses) {
-      clause = read_clause(in, weighted);
+      clause = read_clause_reusing(in, weighted, buffer);
       lcnt += len_clause(clause);
-      free_rule(clause);
       clauses--;
     }
 
   } else {
     initialize_program();
-    rule = read_rule(in);
+    rule = read_rule_reusing(in, buffer);
 
     /* Read rules in one by one and make calculations */
     while(rule) {
@@ -214,8 +216,7 @@ int main(int argc, char **argv)
       } else
 	rcnt++;
       lcnt += len_rule(rule);
-      free_rule(rule);
-      rule = read_rule(in);
+      rule = read_rule_reusing(in, buffer);
     }
     table = read_symbols(in);
     read_compute_statement(in, table);
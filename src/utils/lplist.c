@@ -37,6 +37,7 @@
 #include "atom.h"
 #include "rule.h"
 #include "io.h"
+#include "thread.h"
 
 void _version_lplist_c()
 {
@@ -61,6 +62,7 @@ void usage()
   fprintf(stderr, "   -d           -- input is a cnf in DIMACS format\n");
   fprintf(stderr, "   --gnt        -- generate output for gnt\n");
   fprintf(stderr, "   --dlv        -- generate output for dlv\n");
+  fprintf(stderr, "   --threads=<n> -- use <n> threads for parsing\n");
   fprintf(stderr, "\n");
 
   return;
@@ -107,6 +109,14 @@ int main(int argc, char **argv)
       option_gnt = 1;
     else if(strcmp(arg, "--dlv") == 0)
       option_dlv = 1;
+    else if(strncmp(arg, "--threads=", 10) == 0) {
+      worker_threads = atoi(&arg[10]);
+      if(worker_threads < 1) {
+	fprintf(stderr, "%s: invalid number of threads %s\n",
+		program_name, &arg[10]);
+	exit(-1);
+      }
+    }
     else if(file == NULL)
       file = arg;
     else {
@@ -136,6 +146,9 @@ int main(int argc, char **argv)
     }
   }
 
+  (void) map_input(in);  /* Parse regular files in place */
+  (void) use_rule_arena(new_rule_arena());  /* Released on exit */
+
   if(option_gnt)
     style = STYLE_GNT;
   else if(option_dlv)
@@ -156,18 +169,14 @@ int main(int argc, char **argv)
     if(weighted)
       fputs("weighted ", out);
     fprintf(out, "CNF with %i vars %i clauses", table_size(table), clauses);
-    if(max_weight)
-      fprintf(out, " (max weight = %ld)", max_weight);
+    if(get_max_weight())
+      fprintf(out, " (max weight = %ld)", get_max_weight());
     fputs("\n", out);
 
     write_symbols(style, out, table);
     write_cnf(style, out, program, table);
   } else {
-    program = read_program(in);
-    table = read_symbols(in);
-    read_compute_statement(in, table);
-
-    write_program(style, out, program, table);
+    table = convert_program(style, in, out);  /* Rules are not kept */
     if(style != STYLE_DLV)
       printf("\n#compute {");
     write_compute_statement(style, out, table, MARK_TRUE|MARK_FALSE);
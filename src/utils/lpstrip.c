@@ -37,6 +37,7 @@
 #include "atom.h"
 #include "rule.h"
 #include "io.h"
+#include "thread.h"
 
 void _version_strip_c()
 {
@@ -57,6 +58,9 @@ void usage()
   fprintf(stderr, "options:\n");
   fprintf(stderr, "   -h or --help -- print help message\n");
   fprintf(stderr, "   --version    -- print version information\n");
+  fprintf(stderr, "   --threads=<n> -- use <n> threads for parsing\n");
+  fprintf(stderr, "   --renumber[=<order>] -- number atoms consecutively\n");
+  fprintf(stderr, "        (<order> is number, occurrence, or dependency)\n");
   fprintf(stderr, "\n");
 
   return;
@@ -70,15 +74,15 @@ int main(int argc, char **argv)
   char *file = NULL;
   FILE *in = NULL;
   RULE *program = NULL;
-  RULE *scan = NULL;
   ATAB *table = NULL;
-  int i = 0;
   int number = 0;
 
   FILE *out = stdout;
 
   int option_help = 0;
   int option_version = 0;
+  int option_renumber = 0;
+  int order = ORDER_BY_NUMBER;
   char *arg = NULL;
   int which = 0;
   int style = STYLE_SMODELS;
@@ -92,6 +96,30 @@ int main(int argc, char **argv)
       option_help = -1;
     else if(strcmp(arg, "--version") == 0)
       option_version = 1;
+    else if(strncmp(arg, "--threads=", 10) == 0) {
+      worker_threads = atoi(&arg[10]);
+      if(worker_threads < 1) {
+	fprintf(stderr, "%s: invalid number of threads %s\n",
+		program_name, &arg[10]);
+	exit(-1);
+      }
+    }
+    else if(strcmp(arg, "--renumber") == 0)
+      option_renumber = -1;
+    else if(strncmp(arg, "--renumber=", 11) == 0) {
+      option_renumber = -1;
+      if(strcmp(&arg[11], "number") == 0)
+	order = ORDER_BY_NUMBER;
+      else if(strcmp(&arg[11], "occurrence") == 0)
+	order = ORDER_BY_OCCURRENCE;
+      else if(strcmp(&arg[11], "dependency") == 0)
+	order = ORDER_BY_DEPENDENCY;
+      else {
+	fprintf(stderr, "%s: unknown order %s\n", program_name, &arg[11]);
+	usage();
+	exit(-1);
+      }
+    }
     else if(file == NULL)
       file = arg;
     else {
@@ -116,16 +144,20 @@ int main(int argc, char **argv)
     }
   }
 
+  (void) map_input(in);  /* Parse regular files in place */
+  (void) use_rule_arena(new_rule_arena());  /* Released on exit */
+
   program = read_program(in);
   table = read_symbols(in);
   number = read_compute_statement(in, table);
 
-  mark_occurrences(program, table);
-
   program = strip_program(program, table);
 
   strip_compute_statement(table);
 
+  if(option_renumber)
+    table = renumber_atoms(program, table, order);
+
   write_program(style, out, program, table);
   fprintf(out, "0\n");
 
@@ -151,157 +183,429 @@ int main(int argc, char **argv)
 
 /* -------------------------- Local routines ------------------------------ */
 
-int strip_basic(RULE *rule, ATAB *table)
+/* Rules are stripped by iterating to a fixpoint: the number of remaining
+   occurrences is maintained for each atom and atoms whose counts drop to
+   zero are put on a worklist.  An atom without defining rules is false
+   so that rules depending positively on it can be dropped; a hidden atom
+   that is no longer referenced can be removed together with its defining
+   rules.  Each atom is falsified and removed at most once, so that the
+   total time remains linear in the size of the program. */
+
+#define STRIP_HIDDEN  0x01  /* Has no name */
+#define STRIP_KEEP    0x02  /* Referenced by the compute statement */
+#define STRIP_INPUT   0x04  /* Defined elsewhere */
+#define STRIP_FACT    0x08  /* Defined by a fact */
+#define STRIP_QUEUED  0x10  /* In the worklist */
+#define STRIP_FALSE   0x20  /* Known to be false */
+#define STRIP_REMOVED 0x40  /* Removed from the program */
+
+typedef struct strip {
+  OTAB *occurrences;
+  ATAB *table;
+  char *flags;         /* Flags of atoms (see above) */
+  int *heads;          /* Remaining occurrences in heads */
+  int *bodies;         /* Remaining occurrences in bodies */
+  int *disjunctions;   /* Remaining occurrences in disjunctive heads */
+  int *worklist;
+  int pending;         /* Number of atoms in the worklist */
+  char *dropped;       /* Rules already dropped */
+  long *slacks;        /* Weight of the body of a constraint/weight rule
+			  beyond its bound and the number of remaining
+			  head atoms of a choice rule */
+  int *weights;        /* Weights of positive occurrences in bodies */
+} STRIP;
+
+int is_fact(RULE *rule)
+{
+  switch(rule->type) {
+  case TYPE_BASIC:
+    return rule->data.basic->pos_cnt + rule->data.basic->neg_cnt == 0;
+  case TYPE_CONSTRAINT:
+    return rule->data.constraint->bound <= 0;
+  case TYPE_WEIGHT:
+    return rule->data.weight->bound <= 0;
+  default:
+    return 0;
+  }
+}
+
+void push_atom(STRIP *strip, int atom)
+{
+  if(!(strip->flags[atom] & STRIP_QUEUED)) {
+    strip->flags[atom] |= STRIP_QUEUED;
+    strip->worklist[strip->pending++] = atom;
+  }
+  return;
+}
+
+void drop_rule(STRIP *strip, int i)
 {
-  BASIC_RULE *basic = rule->data.basic;
-  int head = basic->head;
-  int pos_cnt = basic->pos_cnt;
-  int neg_cnt = basic->neg_cnt;
-  int status = get_status(table, head);
+  RULE *rule = (strip->occurrences->rules)[i];
+  int choice = (rule->type == TYPE_CHOICE);
+  int disjunctive = (rule->type == TYPE_DISJUNCTIVE);
+  int cnt = get_head_cnt(rule);
+  int *atoms = get_heads(rule);
+
+  strip->dropped[i] = -1;
+
+  /* Removed heads of choice rules have been accounted for already */
 
-  /* Remove hidden structure which is not needed */
+  while(cnt--) {
+    int atom = *(atoms++);
 
-  if(!visible(table, head)) {
+    if(choice && (strip->flags[atom] & STRIP_REMOVED))
+      continue;
+    if(--(strip->heads[atom]) == 0)
+      push_atom(strip, atom);
+    if(disjunctive && --(strip->disjunctions[atom]) == 0)
+      push_atom(strip, atom);
+  }
+
+  for(cnt=get_pos_cnt(rule), atoms=get_pos(rule); cnt--; atoms++)
+    if(--(strip->bodies[*atoms]) == 0)
+      push_atom(strip, *atoms);
+
+  for(cnt=get_neg_cnt(rule), atoms=get_neg(rule); cnt--; atoms++)
+    if(--(strip->bodies[*atoms]) == 0)
+      push_atom(strip, *atoms);
+
+  return;
+}
 
-    if(pos_cnt+neg_cnt == 0 &&
-       !(status & MARK_POSOCC_OR_NEGOCC) &&
-       !(status & MARK_FALSE)) {
-      set_status(table, head, MARK_UNIQUE);
-      return -1;
+void falsify_atom(STRIP *strip, int atom)
+{
+  OTAB *occurrences = strip->occurrences;
+  int first = (occurrences->starts[OCC_POS])[atom];
+  int cnt = OTAB_CNT(occurrences, OCC_POS, atom);
+  int k = 0;
+
+  strip->flags[atom] |= STRIP_FALSE;
+
+  for(k=first; k<first+cnt; k++) {
+    int i = (occurrences->occs[OCC_POS])[k];
+    RULE *rule = (occurrences->rules)[i];
+
+    if(strip->dropped[i])
+      continue;
+
+    switch(rule->type) {
+    case TYPE_BASIC:
+    case TYPE_CHOICE:
+    case TYPE_DISJUNCTIVE:
+      drop_rule(strip, i);
+      break;
+
+    case TYPE_CONSTRAINT:
+    case TYPE_WEIGHT:
+      strip->slacks[i] -= strip->weights[k];
+      if(strip->slacks[i] < get_bound(rule))
+	drop_rule(strip, i);
+      break;
+
+    default:  /* False literals are removed from optimize statements later */
+      break;
     }
+  }
 
-    if(status & MARK_UNIQUE)
-      return -1;
+  return;
+}
 
-  } else {
+int removable(STRIP *strip, int atom)
+{
+  int flags = strip->flags[atom];
 
-    if(pos_cnt+neg_cnt == 0)
-      set_status(table, head, MARK_UNIQUE);
+  return (flags & STRIP_HIDDEN) && !(flags & STRIP_KEEP) &&
+    !(flags & STRIP_REMOVED) &&
+    strip->bodies[atom] == 0 && strip->disjunctions[atom] == 0;
+}
+
+void remove_atom(STRIP *strip, int atom)
+{
+  OTAB *occurrences = strip->occurrences;
+  int *rules = OTAB_RULES(occurrences, OCC_HEAD, atom);
+  int cnt = OTAB_CNT(occurrences, OCC_HEAD, atom);
+
+  strip->flags[atom] |= STRIP_REMOVED;
+  if(strip->flags[atom] & STRIP_FACT)
+    set_status(strip->table, atom, MARK_UNIQUE);
+
+  while(cnt--) {
+    int i = *(rules++);
+    RULE *rule = (occurrences->rules)[i];
+
+    if(strip->dropped[i])
+      continue;
+
+    if(rule->type == TYPE_CHOICE) {
+      strip->heads[atom]--;
+      if(--(strip->slacks[i]) == 0)
+	drop_rule(strip, i);
+    } else
+      drop_rule(strip, i);
   }
+  push_atom(strip, atom);
 
-  return 0;
+  return;
 }
 
-int strip_constraint(RULE *rule, ATAB *table)
+void init_strip(STRIP *strip, RULE *program, ATAB *table)
 {
-  CONSTRAINT_RULE *constraint = rule->data.constraint;
-  int head = constraint->head;
-  int bound = constraint->bound;
-  int status = get_status(table, head);
+  OTAB *occurrences = index_occurrences(program);
+  int atoms = occurrences->atoms;
+  int count = occurrences->count;
+  int *cursors = NULL;
+  int atom = 0;
+  int i = 0;
 
-  /* Remove hidden structure which is not needed */
+  strip->occurrences = occurrences;
+  strip->table = table;
+  strip->flags = (char *)calloc(atoms+1, sizeof(char));
+  strip->heads = (int *)malloc((atoms+1)*sizeof(int));
+  strip->bodies = (int *)malloc((atoms+1)*sizeof(int));
+  strip->disjunctions = (int *)calloc(atoms+1, sizeof(int));
+  strip->worklist = (int *)malloc((atoms+1)*sizeof(int));
+  strip->pending = 0;
+  strip->dropped = (char *)calloc(count+1, sizeof(char));
+  strip->slacks = (long *)calloc(count+1, sizeof(long));
+  strip->weights =
+    (int *)malloc(((occurrences->starts[OCC_POS])[atoms+1]+1)*sizeof(int));
+  cursors = (int *)malloc((atoms+2)*sizeof(int));
+
+  if(!strip->flags || !strip->heads || !strip->bodies ||
+     !strip->disjunctions || !strip->worklist || !strip->dropped ||
+     !strip->slacks || !strip->weights || !cursors) {
+    fprintf(stderr, "%s: out of memory!\n", program_name);
+    exit(-1);
+  }
 
-  if(!visible(table, head)) {
+  for(atom=1; atom<=atoms; atom++) {
+    strip->heads[atom] = OTAB_CNT(occurrences, OCC_HEAD, atom);
+    strip->bodies[atom] = OTAB_CNT(occurrences, OCC_POS, atom)
+      + OTAB_CNT(occurrences, OCC_NEG, atom);
+  }
 
-    if(bound == 0 &&
-       !(status & MARK_POSOCC_OR_NEGOCC) &&
-       !(status & MARK_FALSE)) {
-      set_status(table, head, MARK_UNIQUE);
-      return -1;
+  /* Weights of positive body literals are recorded in the order of the
+     occurrence lists (i.e., by rule numbers) */
+
+  memcpy(cursors, occurrences->starts[OCC_POS], (atoms+2)*sizeof(int));
+
+  for(i=0; i<count; i++) {
+    RULE *rule = (occurrences->rules)[i];
+    int pos_cnt = get_pos_cnt(rule);
+    int neg_cnt = get_neg_cnt(rule);
+    int *pos = get_pos(rule);
+    int *weight = NULL;
+    int j = 0;
+
+    switch(rule->type) {
+    case TYPE_CONSTRAINT:
+      strip->slacks[i] = pos_cnt + neg_cnt;
+      break;
+
+    case TYPE_WEIGHT:
+      weight = get_weights(rule);
+      for(j=0; j<neg_cnt+pos_cnt; j++)
+	strip->slacks[i] += weight[j];
+      break;
+
+    case TYPE_CHOICE:
+      strip->slacks[i] = get_head_cnt(rule);
+      break;
+
+    case TYPE_DISJUNCTIVE:
+      for(j=0; j<get_head_cnt(rule); j++)
+	strip->disjunctions[(get_heads(rule))[j]]++;
+      break;
+
+    default:
+      break;
     }
 
-    if(status & MARK_UNIQUE)
-      return -1;
-  } else {
+    for(j=0; j<pos_cnt; j++)
+      strip->weights[cursors[pos[j]]++] =
+	weight ? weight[neg_cnt+j] : (rule->type == TYPE_CONSTRAINT);
+
+    if(is_fact(rule))
+      strip->flags[get_head(rule)] |= STRIP_FACT;
+  }
+  free(cursors);
+
+  for(atom=1; atom<=atoms; atom++) {
+    int status = get_status(table, atom);
+    int flags = strip->flags[atom];
+
+    if(invisible(table, atom))
+      flags |= STRIP_HIDDEN;
+    if(status & MARK_INPUT)
+      flags |= STRIP_INPUT | STRIP_KEEP;
+    if((status & MARK_FALSE) || ((status & MARK_TRUE) && !(flags & STRIP_FACT)))
+      flags |= STRIP_KEEP;
+    strip->flags[atom] = flags;
+  }
+
+  /* Rules whose bodies cannot be satisfied at all */
+
+  for(i=0; i<count; i++) {
+    RULE *rule = (occurrences->rules)[i];
 
-    if(bound == 0)
-      set_status(table, head, MARK_UNIQUE);
+    if((rule->type == TYPE_CONSTRAINT || rule->type == TYPE_WEIGHT) &&
+       strip->slacks[i] < get_bound(rule))
+      drop_rule(strip, i);
   }
 
-  return 0;
+  for(atom=atoms; atom>=1; atom--)
+    push_atom(strip, atom);
+
+  return;
 }
 
-int strip_choice(RULE *rule, ATAB *table)
+void free_strip(STRIP *strip)
 {
-  return 0;
+  free_otab(strip->occurrences);
+  free(strip->flags);
+  free(strip->heads);
+  free(strip->bodies);
+  free(strip->disjunctions);
+  free(strip->worklist);
+  free(strip->dropped);
+  free(strip->slacks);
+  free(strip->weights);
+
+  return;
 }
 
-int strip_weight(RULE *rule,  ATAB *table)
+void strip_atoms(STRIP *strip)
 {
-  WEIGHT_RULE *weight = rule->data.weight;
-  int head = weight->head;
-  int bound = weight->bound;
-  int status = get_status(table, head);
+  while(strip->pending) {
+    int atom = strip->worklist[--(strip->pending)];
+    int flags = (strip->flags[atom] &= ~STRIP_QUEUED);
+
+    if(!(flags & (STRIP_FALSE | STRIP_INPUT)) && strip->heads[atom] == 0)
+      falsify_atom(strip, atom);
+
+    if(removable(strip, atom))
+      remove_atom(strip, atom);
+  }
+  return;
+}
 
-  /* Remove hidden structure which is not needed */
+/* Rules that remain are finalized one by one */
 
-  if(!visible(table, head)) {
+void strip_basic(RULE *rule, STRIP *strip)
+{
+  int head = rule->data.basic->head;
 
-    if(bound == 0 &&
-       !(status & MARK_POSOCC_OR_NEGOCC) &&
-       !(status & MARK_FALSE)) {
-      set_status(table, head, MARK_UNIQUE);
-      return -1;
-    }
+  if(is_fact(rule) && !(strip->flags[head] & STRIP_HIDDEN))
+    set_status(strip->table, head, MARK_UNIQUE);
 
-    if(status & MARK_UNIQUE)
-      return -1;
+  return;
+}
 
-  } else {
+void strip_constraint(RULE *rule, STRIP *strip)
+{
+  int head = rule->data.constraint->head;
 
-    if(bound == 0)
-      set_status(table, head, MARK_UNIQUE);
-  }
+  if(is_fact(rule) && !(strip->flags[head] & STRIP_HIDDEN))
+    set_status(strip->table, head, MARK_UNIQUE);
 
-  return 0;
+  return;
 }
 
-int strip_optimize(RULE *rule, ATAB *table)
+void strip_choice(RULE *rule, STRIP *strip)
 {
-  return 0;
+  CHOICE_RULE *choice = rule->data.choice;
+  int *heads = choice->head;
+  int head_cnt = 0;
+  int i = 0;
+
+  /* Remove head atoms that are not needed */
+
+  for(i=0; i<choice->head_cnt; i++)
+    if(!(strip->flags[heads[i]] & STRIP_REMOVED))
+      heads[head_cnt++] = heads[i];
+  choice->head_cnt = head_cnt;
+
+  return;
 }
 
-int strip_disjunctive(RULE *rule, ATAB *table)
+void strip_weight(RULE *rule, STRIP *strip)
 {
-  return 0;
+  int head = rule->data.weight->head;
+
+  if(is_fact(rule) && !(strip->flags[head] & STRIP_HIDDEN))
+    set_status(strip->table, head, MARK_UNIQUE);
+
+  return;
 }
 
-int strip_rule(RULE *rule, ATAB *table)
+void strip_optimize(RULE *rule, STRIP *strip)
 {
-  int answer = 0;
+  OPTIMIZE_RULE *optimize = rule->data.optimize;
+  int neg_cnt = optimize->neg_cnt;
+  int *pos = optimize->pos;
+  int *weight = &(optimize->weight)[neg_cnt];
+  int pos_cnt = 0;
+  int i = 0;
+
+  /* Remove false literals which never contribute */
+
+  for(i=0; i<optimize->pos_cnt; i++)
+    if(!(strip->flags[pos[i]] & STRIP_FALSE)) {
+      weight[pos_cnt] = weight[i];
+      pos[pos_cnt++] = pos[i];
+    }
+  optimize->pos_cnt = pos_cnt;
+
+  return;
+}
 
+void strip_rule(RULE *rule, STRIP *strip)
+{
   switch(rule->type) {
   case TYPE_BASIC:
-    answer = strip_basic(rule, table);
+    strip_basic(rule, strip);
     break;
 
   case TYPE_CONSTRAINT:
-    answer = strip_constraint(rule, table);
+    strip_constraint(rule, strip);
     break;
 
   case TYPE_CHOICE:
-    answer = strip_choice(rule, table);
+    strip_choice(rule, strip);
     break;
 
   case TYPE_WEIGHT:
-    answer = strip_weight(rule, table);
+    strip_weight(rule, strip);
     break;
 
   case TYPE_OPTIMIZE:
-    answer = strip_optimize(rule, table);
+    strip_optimize(rule, strip);
     break;
 
-  case TYPE_DISJUNCTIVE:
-    answer = strip_disjunctive(rule, table);
+  case TYPE_DISJUNCTIVE:  /* Heads are handled by the worklist */
     break;
 
   default:
     error("unknown rule type");
   }
 
-  return answer;
+  return;
 }
 
 RULE *strip_program(RULE *program, ATAB *table)
 {
+  STRIP strip;
   RULE *scan = program;
   RULE *previous = NULL;
+  int i = 0;
+
+  init_strip(&strip, program, table);
+  strip_atoms(&strip);
 
-  while(scan) {
+  for(i=0; scan; i++) {
     RULE *next = scan->next;
-    int drop = strip_rule(scan, table);
 
-    if(drop) {
+    if(strip.dropped[i]) {
       if(previous)
 	previous->next = next;
 
@@ -309,12 +613,16 @@ RULE *strip_program(RULE *program, ATAB *table)
 	program = next;
 
       free_rule(scan);
-    } else
+    } else {
+      strip_rule(scan, &strip);
       previous = scan;
+    }
 
     scan = next;
   }
 
+  free_strip(&strip);
+
   return program;
 }
 
@@ -322,24 +630,18 @@ void strip_compute_statement(ATAB *table)
 {
   while(table) {
     int count = table->count;
-    int *statuses = table->statuses;
     SYMBOL **names = table->names;
     int i = 0;
 
-    for(i=1; i<=count; i++) {  
-      int offset = table->offset;
-      int atom = i+offset;
+    for(i=next_status(table, 1, MARK_UNIQUE); i<=count;
+	i=next_status(table, i+1, MARK_UNIQUE)) {
       SYMBOL *name = names[i];
-      int status = statuses[i];
+      int status = get_piece_status(table, i);
 
-      if(status & MARK_UNIQUE) {
-
-	if(status & MARK_TRUE) statuses[i] &= ~MARK_TRUE;
-
-	if(!name && (status & MARK_FALSE))
-	  statuses[i] |= MARK_TRUE; /* Retain contradiction */
-      }
+      if(status & MARK_TRUE) clear_piece_status(table, i, MARK_TRUE);
 
+      if(!name && (status & MARK_FALSE))
+	set_piece_status(table, i, MARK_TRUE); /* Retain contradiction */
     }
     table = table->next;
   }